@@ -30,3 +30,4 @@
 #define P_PRORES_PROFILE_APCH "Codec.ProRes.Profile.APCH"
 #define P_PRORES_PROFILE_AP4H "Codec.ProRes.Profile.AP4H"
 #define P_PRORES_PROFILE_AP4X "Codec.ProRes.Profile.AP4X"
+#define P_PRORES_ALPHA "Codec.ProRes.Alpha"
@@ -0,0 +1,219 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// Chroma subsampling between planar YUV formats, luma is copied as is.
+// Chroma is filtered with a box filter instead of being decimated. For 4:2:0 the average of each 2x2 block puts the
+// sample at the center of it, which is what setup_obs_color() declares with AVCHROMA_LOC_CENTER.
+
+#include <algorithm>
+#include "converter.hpp"
+
+using namespace obsffmpeg::convert;
+
+//------------------------------------------------------------------------------
+// 2x2 box filter, also used for horizontal only filtering by passing the same row twice.
+//------------------------------------------------------------------------------
+static inline void box_c(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int width, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		int x0 = x * 2;
+		int x1 = std::min(x0 + 1, width - 1);
+		out[x] = static_cast<uint8_t>((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+	}
+}
+
+static int box_none(const uint8_t*, const uint8_t*, uint8_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSSE3 static int box_ssse3(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int count)
+{
+	const __m128i ones  = _mm_set1_epi8(1);
+	const __m128i round = _mm_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		const __m128i* in0 = reinterpret_cast<const __m128i*>(row0 + x * 2);
+		const __m128i* in1 = reinterpret_cast<const __m128i*>(row1 + x * 2);
+		// Multiplying with one and adding neighbours gives the horizontal pair sums as 16-bit values.
+		__m128i lo = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128(in0), ones),
+		                           _mm_maddubs_epi16(_mm_loadu_si128(in1), ones));
+		__m128i hi = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128(in0 + 1), ones),
+		                           _mm_maddubs_epi16(_mm_loadu_si128(in1 + 1), ones));
+		lo         = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+		hi         = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int box_avx2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int count)
+{
+	const __m256i ones  = _mm256_set1_epi8(1);
+	const __m256i round = _mm256_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 32 <= count; x += 32) {
+		const __m256i* in0 = reinterpret_cast<const __m256i*>(row0 + x * 2);
+		const __m256i* in1 = reinterpret_cast<const __m256i*>(row1 + x * 2);
+		__m256i        lo  = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256(in0), ones),
+                                                  _mm256_maddubs_epi16(_mm256_loadu_si256(in1), ones));
+		__m256i        hi  = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256(in0 + 1), ones),
+                                                  _mm256_maddubs_epi16(_mm256_loadu_si256(in1 + 1), ones));
+		lo                 = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 2);
+		hi                 = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 2);
+		// Packing works per lane, reorder the 64-bit quarters to get 32 consecutive samples.
+		__m256i res = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), res);
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Vertical 2-tap filter
+//------------------------------------------------------------------------------
+static inline void average_c(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		out[x] = static_cast<uint8_t>((row0[x] + row1[x] + 1) >> 1);
+	}
+}
+
+static int average_none(const uint8_t*, const uint8_t*, uint8_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSE2 static int average_sse2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int count)
+{
+	// pavgb rounds up, which is exactly (a + b + 1) >> 1.
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_avg_epu8(a, b));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int average_avx2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int count)
+{
+	int x = 0;
+	for (; x + 32 <= count; x += 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_avg_epu8(a, b));
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Kernels
+//------------------------------------------------------------------------------
+typedef int (*filter_t)(const uint8_t*, const uint8_t*, uint8_t*, int);
+
+template<filter_t Simd>
+static void i444_to_i420(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	copy_rows(src[0], src_linesize[0], dst[0], dst_linesize[0], ctx.width, row_begin, row_end);
+
+	int count = (ctx.width + 1) / 2;
+	for (int row = row_begin; row < row_end; row += 2) {
+		// The last row of an odd height frame is paired with itself.
+		int next = std::min(row + 1, ctx.height - 1);
+		for (size_t plane = 1; plane < 3; plane++) {
+			const uint8_t* row0 = src[plane] + static_cast<ptrdiff_t>(src_linesize[plane]) * row;
+			const uint8_t* row1 = src[plane] + static_cast<ptrdiff_t>(src_linesize[plane]) * next;
+			uint8_t*       out  = dst[plane] + static_cast<ptrdiff_t>(dst_linesize[plane]) * (row / 2);
+			box_c(row0, row1, out, ctx.width, Simd(row0, row1, out, ctx.width / 2), count);
+		}
+	}
+}
+
+template<filter_t Simd>
+static void i444_to_i422(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	copy_rows(src[0], src_linesize[0], dst[0], dst_linesize[0], ctx.width, row_begin, row_end);
+
+	int count = (ctx.width + 1) / 2;
+	for (int row = row_begin; row < row_end; row++) {
+		for (size_t plane = 1; plane < 3; plane++) {
+			const uint8_t* in  = src[plane] + static_cast<ptrdiff_t>(src_linesize[plane]) * row;
+			uint8_t*       out = dst[plane] + static_cast<ptrdiff_t>(dst_linesize[plane]) * row;
+			box_c(in, in, out, ctx.width, Simd(in, in, out, ctx.width / 2), count);
+		}
+	}
+}
+
+template<filter_t Simd>
+static void i422_to_i420(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	copy_rows(src[0], src_linesize[0], dst[0], dst_linesize[0], ctx.width, row_begin, row_end);
+
+	int count = (ctx.width + 1) / 2;
+	for (int row = row_begin; row < row_end; row += 2) {
+		int next = std::min(row + 1, ctx.height - 1);
+		for (size_t plane = 1; plane < 3; plane++) {
+			const uint8_t* row0 = src[plane] + static_cast<ptrdiff_t>(src_linesize[plane]) * row;
+			const uint8_t* row1 = src[plane] + static_cast<ptrdiff_t>(src_linesize[plane]) * next;
+			uint8_t*       out  = dst[plane] + static_cast<ptrdiff_t>(dst_linesize[plane]) * (row / 2);
+			average_c(row0, row1, out, Simd(row0, row1, out, count), count);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Registration
+//------------------------------------------------------------------------------
+void obsffmpeg::convert::register_chroma_kernels(std::vector<kernel_info>& kernels)
+{
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV420P, simd_level::NONE, "I444 to I420 (C)",
+	                   i444_to_i420<box_none>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P, simd_level::NONE, "I444 to I422 (C)",
+	                   i444_to_i422<box_none>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV420P, simd_level::NONE, "I422 to I420 (C)",
+	                   i422_to_i420<average_none>, nullptr, 2});
+
+#ifdef OBSFFMPEG_SIMD_X86
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV420P, simd_level::SSSE3, "I444 to I420 (SSSE3)",
+	                   i444_to_i420<box_ssse3>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV420P, simd_level::AVX2, "I444 to I420 (AVX2)",
+	                   i444_to_i420<box_avx2>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P, simd_level::SSSE3, "I444 to I422 (SSSE3)",
+	                   i444_to_i422<box_ssse3>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P, simd_level::AVX2, "I444 to I422 (AVX2)",
+	                   i444_to_i422<box_avx2>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV420P, simd_level::SSE2, "I422 to I420 (SSE2)",
+	                   i422_to_i420<average_sse2>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV420P, simd_level::AVX2, "I422 to I420 (AVX2)",
+	                   i422_to_i420<average_avx2>, nullptr, 2});
+#endif
+}
@@ -0,0 +1,129 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "converter.hpp"
+#include <algorithm>
+
+// Bands smaller than this cost more in synchronization than they save.
+static constexpr int band_min_rows = 64;
+
+static std::vector<obsffmpeg::convert::kernel_info> const& get_kernels()
+{
+	static std::vector<obsffmpeg::convert::kernel_info> kernels = []() {
+		std::vector<obsffmpeg::convert::kernel_info> list;
+		obsffmpeg::convert::register_repack_kernels(list);
+		obsffmpeg::convert::register_rgb_kernels(list);
+		obsffmpeg::convert::register_chroma_kernels(list);
+		obsffmpeg::convert::register_widen_kernels(list);
+
+		// Prefer the most advanced instruction set available.
+		std::stable_sort(list.begin(), list.end(),
+		                 [](auto const& a, auto const& b) { return a.level > b.level; });
+		return list;
+	}();
+	return kernels;
+}
+
+obsffmpeg::convert::converter::converter() : _info(), _context(), _valid(false) {}
+
+bool obsffmpeg::convert::converter::initialize(AVPixelFormat source, bool source_full_range,
+                                               AVColorSpace source_colorspace, AVPixelFormat target,
+                                               bool target_full_range, AVColorSpace target_colorspace, int width,
+                                               int height, std::shared_ptr<obsffmpeg::threadpool> threads)
+{
+	_valid   = false;
+	_threads = threads;
+	_bands.clear();
+
+	auto level = get_simd_level();
+	for (auto& info : get_kernels()) {
+		if ((info.source != source) || (info.target != target) || (info.level > level))
+			continue;
+
+		kernel_context ctx = {};
+		ctx.width          = width;
+		ctx.height         = height;
+		ctx.full_range     = target_full_range;
+		if (info.prepare) {
+			if (!info.prepare(ctx, source_full_range, source_colorspace, target_full_range,
+			                  target_colorspace))
+				continue;
+		} else if ((source_full_range != target_full_range) || (source_colorspace != target_colorspace)) {
+			continue;
+		}
+
+		_info    = info;
+		_context = ctx;
+		_valid   = true;
+		break;
+	}
+	if (!_valid)
+		return false;
+
+	// One band per thread, aligned to what the kernel needs and to whole analysis blocks.
+	size_t count = _threads ? _threads->size() : 1;
+	int    align = std::max(_info.row_alignment, static_cast<int>(frame_analysis::block_size));
+	int    rows  = static_cast<int>((static_cast<size_t>(height) + count - 1) / count);
+	rows         = std::max(rows, band_min_rows);
+	rows         = (rows + align - 1) / align * align;
+	for (int row = 0; row < height; row += rows) {
+		_bands.emplace_back(row, std::min(row + rows, height));
+	}
+
+	return true;
+}
+
+bool obsffmpeg::convert::converter::is_valid()
+{
+	return _valid;
+}
+
+const char* obsffmpeg::convert::converter::get_name()
+{
+	return _valid ? _info.name : "None";
+}
+
+void obsffmpeg::convert::converter::convert_band(std::pair<int, int> const& band, const uint8_t* const src[],
+                                                 const int src_linesize[], uint8_t* const dst[],
+                                                 const int dst_linesize[], frame_analysis* analysis)
+{
+	if (analysis) {
+		analysis->hash_rows(src[0], static_cast<size_t>(src_linesize[0]), static_cast<size_t>(band.first),
+		                    static_cast<size_t>(band.second));
+	}
+	_info.kernel(_context, src, src_linesize, dst, dst_linesize, band.first, band.second);
+}
+
+void obsffmpeg::convert::converter::convert(const uint8_t* const src[], const int src_linesize[],
+                                            uint8_t* const dst[], const int dst_linesize[],
+                                            frame_analysis* analysis)
+{
+	if (_threads && (_bands.size() > 1)) {
+		_threads->parallel_for(_bands.size(), [&](size_t idx) {
+			convert_band(_bands[idx], src, src_linesize, dst, dst_linesize, analysis);
+		});
+	} else {
+		for (auto& band : _bands) {
+			convert_band(band, src, src_linesize, dst, dst_linesize, analysis);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+#include <vector>
+#include "frame-analysis.hpp"
+#include "kernel.hpp"
+#include "threadpool.hpp"
+
+namespace obsffmpeg {
+	namespace convert {
+		// Converts between a fixed pair of formats with dedicated kernels, as an alternative to swscale.
+		class converter {
+			kernel_info    _info;
+			kernel_context _context;
+			bool           _valid;
+
+			std::vector<std::pair<int, int>>       _bands;
+			std::shared_ptr<obsffmpeg::threadpool> _threads;
+
+			void convert_band(std::pair<int, int> const& band, const uint8_t* const src[],
+			                  const int src_linesize[], uint8_t* const dst[], const int dst_linesize[],
+			                  frame_analysis* analysis);
+
+			public:
+			converter();
+
+			// Returns false if there is no kernel for this conversion, convert() must not be used then.
+			bool initialize(AVPixelFormat source, bool source_full_range, AVColorSpace source_colorspace,
+			                AVPixelFormat target, bool target_full_range, AVColorSpace target_colorspace,
+			                int width, int height,
+			                std::shared_ptr<obsffmpeg::threadpool> threads = nullptr);
+
+			bool is_valid();
+
+			const char* get_name();
+
+			// If analysis is given, each band hashes its rows of the first source plane before converting
+			// them.
+			void convert(const uint8_t* const src[], const int src_linesize[], uint8_t* const dst[],
+			             const int dst_linesize[], frame_analysis* analysis = nullptr);
+		};
+
+		// Kernel registration, implemented by each kernel family.
+		void register_repack_kernels(std::vector<kernel_info>& kernels);
+		void register_rgb_kernels(std::vector<kernel_info>& kernels);
+		void register_chroma_kernels(std::vector<kernel_info>& kernels);
+		void register_widen_kernels(std::vector<kernel_info>& kernels);
+	} // namespace convert
+} // namespace obsffmpeg
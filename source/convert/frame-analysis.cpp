@@ -0,0 +1,300 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "frame-analysis.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#pragma warning(pop)
+}
+
+// Identifies our data in AVFrame::opaque_ref.
+static constexpr uint32_t header_magic = 0x4146464Fu;
+
+// Blocks are hashed with four independent lanes, so that the multiplications of one lane can overlap with the others.
+// The rounds are those of xxHash64.
+static constexpr size_t   hash_lanes = 4;
+static constexpr uint64_t prime1     = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t prime2     = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t prime3     = 0x165667B19E3779F9ull;
+static constexpr uint64_t prime4     = 0x85EBCA77C2B2AE63ull;
+
+struct header {
+	uint32_t                                magic;
+	obsffmpeg::convert::frame_analysis_data data;
+};
+
+static inline uint64_t rotl(uint64_t v, int r)
+{
+	return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+	return rotl(acc + input * prime2, 31) * prime1;
+}
+
+static inline uint64_t avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+static inline uint64_t load64(const uint8_t* data)
+{
+	uint64_t v;
+	std::memcpy(&v, data, sizeof(v));
+	return v;
+}
+
+static const obsffmpeg::convert::frame_analysis_data* get_data(const AVBufferRef* buf)
+{
+	if (!buf || (static_cast<size_t>(buf->size) < sizeof(header)))
+		return nullptr;
+
+	auto hdr = reinterpret_cast<const header*>(buf->data);
+	if (hdr->magic != header_magic)
+		return nullptr;
+	return &hdr->data;
+}
+
+const obsffmpeg::convert::frame_analysis_data* obsffmpeg::convert::frame_analysis_data::get(const AVFrame* frame)
+{
+	return get_data(frame->opaque_ref);
+}
+
+obsffmpeg::convert::frame_analysis::frame_analysis()
+    : _row_bytes(0), _block_bytes(0), _rows(0), _blocks_x(0), _blocks_y(0), _have_previous(false),
+      _format(AV_PIX_FMT_NONE), _width(0), _other_hash(0), _other_previous(0), _other_hashed(false),
+      _data_pool(nullptr), _data_size(0), _result(nullptr)
+{}
+
+obsffmpeg::convert::frame_analysis::~frame_analysis()
+{
+	av_buffer_unref(&_result);
+	av_buffer_pool_uninit(&_data_pool);
+}
+
+void obsffmpeg::convert::frame_analysis::initialize(AVPixelFormat format, int width, int height)
+{
+	av_buffer_unref(&_result);
+	av_buffer_pool_uninit(&_data_pool);
+	_blocks_x = _blocks_y = 0;
+	_have_previous        = false;
+	_format               = format;
+	_width                = width;
+	_other_hash           = 0;
+	_other_hashed         = false;
+
+	int row_bytes = av_image_get_linesize(format, width, 0);
+	if ((row_bytes <= 0) || (height <= 0))
+		return;
+
+	// Blocks cover the same number of pixels for every format, packed formats just have more bytes per pixel.
+	_row_bytes   = static_cast<size_t>(row_bytes);
+	_block_bytes = std::max<size_t>(1, _row_bytes / static_cast<size_t>(width)) * block_size;
+	_rows        = static_cast<size_t>(height);
+	_blocks_x    = static_cast<uint32_t>((_row_bytes + _block_bytes - 1) / _block_bytes);
+	_blocks_y    = static_cast<uint32_t>((_rows + block_size - 1) / block_size);
+	_hashes.assign(static_cast<size_t>(_blocks_x) * _blocks_y * hash_lanes, 0);
+	_previous.assign(static_cast<size_t>(_blocks_x) * _blocks_y, 0);
+
+	size_t words = (static_cast<size_t>(_blocks_x) * _blocks_y + 63) / 64;
+	_data_size   = sizeof(header) + words * sizeof(uint64_t);
+	_data_pool   = av_buffer_pool_init(static_cast<int>(_data_size), av_buffer_allocz);
+	if (!_data_pool)
+		throw std::runtime_error("Failed to create pool for frame analysis data.");
+}
+
+bool obsffmpeg::convert::frame_analysis::is_valid()
+{
+	return _data_pool != nullptr;
+}
+
+void obsffmpeg::convert::frame_analysis::hash_row(const uint8_t* data, size_t row)
+{
+	uint64_t* lanes     = &_hashes[(row / block_size) * _blocks_x * hash_lanes];
+	bool      first_row = (row % block_size) == 0;
+
+	for (size_t bx = 0; bx < _blocks_x; bx++, lanes += hash_lanes) {
+		const uint8_t* ptr   = data + bx * _block_bytes;
+		size_t         bytes = std::min(_block_bytes, _row_bytes - bx * _block_bytes);
+
+		uint64_t v0 = lanes[0], v1 = lanes[1], v2 = lanes[2], v3 = lanes[3];
+		if (first_row) {
+			v0 = prime1 + prime2;
+			v1 = prime2;
+			v2 = 0;
+			v3 = 0 - prime1;
+		}
+
+		for (; bytes >= 32; bytes -= 32, ptr += 32) {
+			v0 = hash_round(v0, load64(ptr));
+			v1 = hash_round(v1, load64(ptr + 8));
+			v2 = hash_round(v2, load64(ptr + 16));
+			v3 = hash_round(v3, load64(ptr + 24));
+		}
+		for (; bytes >= 8; bytes -= 8, ptr += 8) {
+			v0 = hash_round(v0, load64(ptr));
+		}
+		if (bytes > 0) {
+			uint64_t tail = 0;
+			std::memcpy(&tail, ptr, bytes);
+			v1 = hash_round(v1, tail);
+		}
+
+		lanes[0] = v0;
+		lanes[1] = v1;
+		lanes[2] = v2;
+		lanes[3] = v3;
+	}
+}
+
+void obsffmpeg::convert::frame_analysis::hash_rows(const uint8_t* data, size_t linesize, size_t row_begin,
+                                                   size_t row_end)
+{
+	row_end = std::min(row_end, _rows);
+	for (size_t row = row_begin; row < row_end; row++) {
+		hash_row(data + linesize * row, row);
+	}
+}
+
+void obsffmpeg::convert::frame_analysis::hash_plane(const uint8_t* data, size_t linesize,
+                                                    std::shared_ptr<obsffmpeg::threadpool> threads)
+{
+	if (threads && (threads->size() > 1)) {
+		threads->parallel_for(_blocks_y, [this, data, linesize](size_t idx) {
+			hash_rows(data, linesize, idx * block_size, (idx + 1) * block_size);
+		});
+	} else {
+		hash_rows(data, linesize, 0, _rows);
+	}
+}
+
+void obsffmpeg::convert::frame_analysis::hash_other_plane(size_t plane, const uint8_t* data, size_t linesize)
+{
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(_format);
+	int row_bytes = av_image_get_linesize(_format, _width, static_cast<int>(plane));
+	if (!desc || (row_bytes <= 0))
+		return;
+
+	size_t rows = static_cast<size_t>(AV_CEIL_RSHIFT(static_cast<int>(_rows), desc->log2_chroma_h));
+	if (!_other_hashed) {
+		_other_hash   = prime4;
+		_other_hashed = true;
+	}
+
+	uint64_t v0 = prime1 + prime2 + plane, v1 = prime2, v2 = 0, v3 = 0 - prime1;
+	for (size_t row = 0; row < rows; row++) {
+		const uint8_t* ptr   = data + linesize * row;
+		size_t         bytes = static_cast<size_t>(row_bytes);
+
+		for (; bytes >= 32; bytes -= 32, ptr += 32) {
+			v0 = hash_round(v0, load64(ptr));
+			v1 = hash_round(v1, load64(ptr + 8));
+			v2 = hash_round(v2, load64(ptr + 16));
+			v3 = hash_round(v3, load64(ptr + 24));
+		}
+		for (; bytes >= 8; bytes -= 8, ptr += 8) {
+			v0 = hash_round(v0, load64(ptr));
+		}
+		if (bytes > 0) {
+			uint64_t tail = 0;
+			std::memcpy(&tail, ptr, bytes);
+			v1 = hash_round(v1, tail);
+		}
+	}
+
+	uint64_t h  = avalanche(rotl(v0, 1) + rotl(v1, 7) + rotl(v2, 12) + rotl(v3, 18));
+	_other_hash = hash_round(_other_hash, h);
+}
+
+void obsffmpeg::convert::frame_analysis::finish(AVFrame* frame)
+{
+	AVBufferRef* buf = av_buffer_pool_get(_data_pool);
+	if (!buf)
+		throw std::runtime_error("Failed to allocate frame analysis data.");
+	std::memset(buf->data, 0, _data_size);
+
+	auto hdr                 = reinterpret_cast<header*>(buf->data);
+	auto bitmap              = reinterpret_cast<uint64_t*>(&hdr->data + 1);
+	hdr->magic               = header_magic;
+	hdr->data.blocks_x       = _blocks_x;
+	hdr->data.blocks_y       = _blocks_y;
+	hdr->data.first          = !_have_previous;
+	hdr->data.hash           = prime4;
+	hdr->data.changed_blocks = 0;
+
+	size_t blocks = static_cast<size_t>(_blocks_x) * _blocks_y;
+	for (size_t idx = 0; idx < blocks; idx++) {
+		const uint64_t* lanes = &_hashes[idx * hash_lanes];
+		uint64_t        h     = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+		h                     = avalanche(h);
+
+		if (!_have_previous || (h != _previous[idx])) {
+			bitmap[idx / 64] |= 1ull << (idx % 64);
+			hdr->data.changed_blocks++;
+		}
+		_previous[idx] = h;
+		hdr->data.hash = hash_round(hdr->data.hash, h);
+	}
+	hdr->data.hash = avalanche(hdr->data.hash);
+
+	if (_other_hashed) {
+		hdr->data.other_planes_changed = !_have_previous || (_other_hash != _other_previous);
+		_other_previous                = _other_hash;
+		_other_hashed                  = false;
+	}
+	_have_previous = true;
+
+	av_buffer_unref(&_result);
+	_result = buf;
+	if (frame)
+		attach(frame);
+}
+
+const obsffmpeg::convert::frame_analysis_data* obsffmpeg::convert::frame_analysis::get_result()
+{
+	return get_data(_result);
+}
+
+void obsffmpeg::convert::frame_analysis::attach(AVFrame* frame)
+{
+	if (!_result)
+		return;
+
+	av_buffer_unref(&frame->opaque_ref);
+	frame->opaque_ref = av_buffer_ref(_result);
+	if (!frame->opaque_ref)
+		throw std::runtime_error("Failed to reference frame analysis data.");
+}
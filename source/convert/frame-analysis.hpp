@@ -0,0 +1,126 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+#include <vector>
+#include "threadpool.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	namespace convert {
+		// Result of analysing a frame, attached to the AVFrame as opaque_ref.
+		// The change bitmap follows directly after this header, one bit per block in row-major order.
+		struct frame_analysis_data {
+			uint64_t hash;
+			uint32_t blocks_x;
+			uint32_t blocks_y;
+			uint32_t changed_blocks;
+
+			// Set if there was no previous frame to compare with, every block counts as changed then.
+			bool first;
+
+			// Set if one of the other planes changed.
+			// Only known if they were hashed with hash_other_plane(), always false otherwise.
+			bool other_planes_changed;
+
+			bool is_duplicate() const
+			{
+				return !first && (changed_blocks == 0) && !other_planes_changed;
+			}
+
+			bool is_changed(uint32_t x, uint32_t y) const
+			{
+				size_t idx = static_cast<size_t>(y) * blocks_x + x;
+				return (reinterpret_cast<const uint64_t*>(this + 1)[idx / 64] >> (idx % 64)) & 1;
+			}
+
+			// Returns nullptr if the frame was not analysed.
+			static const frame_analysis_data* get(const AVFrame* frame);
+		};
+
+		// Hashes the first plane of the source frame in blocks, to find duplicate frames and changed regions.
+		// Rows can be fed in from multiple threads as long as each block row is handled by a single one, which
+		// is why bands and stripes handing rows to this start on multiples of block_size.
+		class frame_analysis {
+			size_t _row_bytes;
+			size_t _block_bytes;
+			size_t _rows;
+
+			uint32_t              _blocks_x;
+			uint32_t              _blocks_y;
+			std::vector<uint64_t> _hashes;
+			std::vector<uint64_t> _previous;
+			bool                  _have_previous;
+
+			AVPixelFormat _format;
+			int           _width;
+			uint64_t      _other_hash;
+			uint64_t      _other_previous;
+			bool          _other_hashed;
+
+			AVBufferPool* _data_pool;
+			size_t        _data_size;
+			AVBufferRef*  _result;
+
+			public:
+			static const int block_size = 64;
+
+			frame_analysis();
+			~frame_analysis();
+
+			void initialize(AVPixelFormat format, int width, int height);
+
+			bool is_valid();
+
+			// Adds a single row to the hashes, rows of a block must arrive in order.
+			void hash_row(const uint8_t* data, size_t row);
+
+			void hash_rows(const uint8_t* data, size_t linesize, size_t row_begin, size_t row_end);
+
+			// Hashes a whole plane, for conversions that don't feed rows in themselves.
+			void hash_plane(const uint8_t* data, size_t linesize,
+			                std::shared_ptr<obsffmpeg::threadpool> threads = nullptr);
+
+			// Hashes one of the other planes as a whole, so changes only visible in them are noticed too.
+			void hash_other_plane(size_t plane, const uint8_t* data, size_t linesize);
+
+			// Compares with the previous frame, and attaches the result to the frame if one is given.
+			void finish(AVFrame* frame = nullptr);
+
+			// Result of the last finish(), or nullptr if there is none.
+			const frame_analysis_data* get_result();
+
+			void attach(AVFrame* frame);
+		};
+	} // namespace convert
+} // namespace obsffmpeg
@@ -0,0 +1,81 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+#include "simd.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	namespace convert {
+		struct kernel_context {
+			int width;
+			int height;
+
+			// Kernel specific data, filled in by the prepare function of a kernel.
+			bool    full_range;
+			int32_t coefficients[16];
+		};
+
+		// Converts the rows [row_begin, row_end) of a frame, where rows are counted in luma rows.
+		// Kernels must only touch the rows they are given, so that a frame can be split into bands.
+		typedef void (*kernel_t)(kernel_context const& ctx, const uint8_t* const src[],
+		                         const int src_linesize[], uint8_t* const dst[], const int dst_linesize[],
+		                         int row_begin, int row_end);
+
+		// Sets up the kernel context for a specific color conversion, returns false if it is not supported.
+		// Kernels without a prepare function only move data around and require identical source and target
+		// color space and range.
+		typedef bool (*prepare_t)(kernel_context& ctx, bool source_full_range, AVColorSpace source_colorspace,
+		                          bool target_full_range, AVColorSpace target_colorspace);
+
+		struct kernel_info {
+			AVPixelFormat source;
+			AVPixelFormat target;
+			simd_level    level;
+			const char*   name;
+			kernel_t      kernel;
+			prepare_t     prepare;
+
+			// Bands handed to the kernel always start on a multiple of this.
+			int row_alignment;
+		};
+
+		// Copies a plane that does not change between source and target, like luma in most conversions.
+		inline void copy_rows(const uint8_t* src, int src_linesize, uint8_t* dst, int dst_linesize, int width,
+		                      int row_begin, int row_end)
+		{
+			for (int y = row_begin; y < row_end; y++) {
+				std::memcpy(dst + static_cast<ptrdiff_t>(dst_linesize) * y,
+				            src + static_cast<ptrdiff_t>(src_linesize) * y, static_cast<size_t>(width));
+			}
+		}
+	} // namespace convert
+} // namespace obsffmpeg
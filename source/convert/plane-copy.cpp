@@ -0,0 +1,239 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "plane-copy.hpp"
+#include <algorithm>
+#include <cstring>
+#include "simd.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#pragma warning(pop)
+}
+
+// Stripes smaller than this cost more in synchronization than they save.
+static constexpr size_t stripe_min_size = 256 * 1024;
+
+static void copy_memcpy(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	std::memcpy(dst, src, bytes);
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+// Non-temporal copies bypass the cache on the way to memory, which keeps frames larger than the cache from evicting
+// everything the encoder is working on. Callers have to issue a store fence once they are done.
+OBSFFMPEG_TARGET_SSE2 static void copy_stream_sse2(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+	if (head > bytes)
+		head = bytes;
+	std::memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	bytes -= head;
+
+	for (; bytes >= 64; bytes -= 64, dst += 64, src += 64) {
+		__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+		__m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+		__m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst), v0);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), v1);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), v2);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), v3);
+	}
+	for (; bytes >= 16; bytes -= 16, dst += 16, src += 16) {
+		_mm_stream_si128(reinterpret_cast<__m128i*>(dst),
+		                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+	}
+	std::memcpy(dst, src, bytes);
+}
+
+OBSFFMPEG_TARGET_AVX2 static void copy_stream_avx2(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	size_t head = (32 - (reinterpret_cast<uintptr_t>(dst) & 31)) & 31;
+	if (head > bytes)
+		head = bytes;
+	std::memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	bytes -= head;
+
+	for (; bytes >= 128; bytes -= 128, dst += 128, src += 128) {
+		__m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+		__m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+		__m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+		__m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dst), v0);
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), v1);
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), v2);
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), v3);
+	}
+	for (; bytes >= 32; bytes -= 32, dst += 32, src += 32) {
+		_mm256_stream_si256(reinterpret_cast<__m256i*>(dst),
+		                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+	}
+	std::memcpy(dst, src, bytes);
+}
+#endif
+
+obsffmpeg::convert::plane_copy::plane_copy()
+    : _streaming(false), _streaming_threshold(0), _kernel(copy_memcpy), _kernel_name("memcpy")
+{}
+
+void obsffmpeg::convert::plane_copy::initialize(AVPixelFormat format, int width, int height,
+                                                std::shared_ptr<obsffmpeg::threadpool> threads)
+{
+	_planes.clear();
+	_stripes.clear();
+	_threads = threads;
+
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift, &v_chroma_shift);
+
+	size_t frame_bytes = 0;
+	for (int idx = 0; idx < av_pix_fmt_count_planes(format); idx++) {
+		int rows = ((idx == 1) || (idx == 2)) ? AV_CEIL_RSHIFT(height, v_chroma_shift) : height;
+
+		plane_plan plan;
+		plan.row_bytes = static_cast<size_t>(av_image_get_linesize(format, width, idx));
+		plan.rows      = static_cast<size_t>(rows);
+		_planes.push_back(plan);
+		frame_bytes += plan.row_bytes * plan.rows;
+	}
+
+	// Split planes into stripes of whole rows, one per thread unless that would make them too small.
+	size_t thread_count = _threads ? _threads->size() : 1;
+	for (size_t idx = 0; idx < _planes.size(); idx++) {
+		auto&  plan    = _planes[idx];
+		size_t stripes = std::max<size_t>(1, (plan.row_bytes * plan.rows) / stripe_min_size);
+		stripes        = std::min(thread_count, stripes);
+		size_t rows    = (plan.rows + stripes - 1) / stripes;
+		if (idx == 0) {
+			// Stripes of the first plane may be analysed, which works on whole blocks.
+			rows = (rows + frame_analysis::block_size - 1) / frame_analysis::block_size
+			       * frame_analysis::block_size;
+		}
+		for (size_t row = 0; row < plan.rows; row += rows) {
+			_stripes.push_back({idx, row, std::min(row + rows, plan.rows)});
+		}
+	}
+
+	// Frames that don't fit into the last level cache would only evict useful data on their way to memory.
+	_streaming   = frame_bytes > (_streaming_threshold ? _streaming_threshold : get_llc_size());
+	_kernel      = copy_memcpy;
+	_kernel_name = "memcpy";
+#ifdef OBSFFMPEG_SIMD_X86
+	if (_streaming) {
+		auto level = get_simd_level();
+		if (level >= simd_level::AVX2) {
+			_kernel      = copy_stream_avx2;
+			_kernel_name = "AVX2 (non-temporal)";
+		} else if (level >= simd_level::SSE2) {
+			_kernel      = copy_stream_sse2;
+			_kernel_name = "SSE2 (non-temporal)";
+		} else {
+			_streaming = false;
+		}
+	}
+#else
+	_streaming = false;
+#endif
+}
+
+void obsffmpeg::convert::plane_copy::copy_stripe(stripe const& stripe, uint8_t* const src[],
+                                                 const uint32_t src_linesize[], uint8_t* const dst[],
+                                                 const int dst_linesize[], frame_analysis* analysis)
+{
+	auto& plan = _planes[stripe.plane];
+	if (!src[stripe.plane] || !dst[stripe.plane])
+		return;
+
+	size_t ls_in  = src_linesize[stripe.plane];
+	size_t ls_out = static_cast<size_t>(dst_linesize[stripe.plane]);
+	size_t bytes  = std::min(plan.row_bytes, std::min(ls_in, ls_out));
+
+	const uint8_t* from = src[stripe.plane] + ls_in * stripe.row_begin;
+	uint8_t*       to   = dst[stripe.plane] + ls_out * stripe.row_begin;
+	size_t         rows = stripe.row_end - stripe.row_begin;
+
+	if (analysis && (stripe.plane == 0)) {
+		// Hash each row right after copying it, while it is still in the cache.
+		for (size_t y = stripe.row_begin; y < stripe.row_end; y++) {
+			_kernel(to, from, bytes);
+			analysis->hash_row(from, y);
+			to += ls_out;
+			from += ls_in;
+		}
+	} else if (ls_in == ls_out) {
+		// Identical layout, copy the whole stripe at once.
+		_kernel(to, from, ls_in * (rows - 1) + bytes);
+	} else {
+		for (size_t y = 0; y < rows; y++) {
+			_kernel(to, from, bytes);
+			to += ls_out;
+			from += ls_in;
+		}
+	}
+
+#ifdef OBSFFMPEG_SIMD_X86
+	if (_streaming)
+		_mm_sfence();
+#endif
+}
+
+void obsffmpeg::convert::plane_copy::copy(uint8_t* const src[], const uint32_t src_linesize[], uint8_t* const dst[],
+                                          const int dst_linesize[], frame_analysis* analysis)
+{
+	if (_threads && (_stripes.size() > _planes.size())) {
+		_threads->parallel_for(_stripes.size(), [&](size_t idx) {
+			copy_stripe(_stripes[idx], src, src_linesize, dst, dst_linesize, analysis);
+		});
+	} else {
+		for (auto& stripe : _stripes) {
+			copy_stripe(stripe, src, src_linesize, dst, dst_linesize, analysis);
+		}
+	}
+}
+
+bool obsffmpeg::convert::plane_copy::is_streaming()
+{
+	return _streaming;
+}
+
+void obsffmpeg::convert::plane_copy::set_streaming_threshold(size_t bytes)
+{
+	_streaming_threshold = bytes;
+}
+
+const char* obsffmpeg::convert::plane_copy::get_kernel_name()
+{
+	return _kernel_name;
+}
+
+size_t obsffmpeg::convert::plane_copy::get_stripe_count()
+{
+	return _stripes.size();
+}
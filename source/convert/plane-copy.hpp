@@ -0,0 +1,90 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <memory>
+#include <vector>
+#include "frame-analysis.hpp"
+#include "threadpool.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	namespace convert {
+		typedef void (*copy_kernel_t)(uint8_t* dst, const uint8_t* src, size_t bytes);
+
+		// Copies frames of one fixed format and resolution between buffers with arbitrary line sizes.
+		// All per-plane work is planned once in initialize(), copy() only walks the plan.
+		class plane_copy {
+			struct plane_plan {
+				size_t row_bytes;
+				size_t rows;
+			};
+
+			struct stripe {
+				size_t plane;
+				size_t row_begin;
+				size_t row_end;
+			};
+
+			std::vector<plane_plan> _planes;
+			std::vector<stripe>     _stripes;
+
+			bool          _streaming;
+			size_t        _streaming_threshold;
+			copy_kernel_t _kernel;
+			const char*   _kernel_name;
+
+			std::shared_ptr<obsffmpeg::threadpool> _threads;
+
+			void copy_stripe(stripe const& stripe, uint8_t* const src[], const uint32_t src_linesize[],
+			                 uint8_t* const dst[], const int dst_linesize[], frame_analysis* analysis);
+
+			public:
+			plane_copy();
+
+			// Stripes are only used if a thread pool with more than one thread is given.
+			void initialize(AVPixelFormat format, int width, int height,
+			                std::shared_ptr<obsffmpeg::threadpool> threads = nullptr);
+
+			// If analysis is given, the first plane is hashed row by row while it is copied.
+			void copy(uint8_t* const src[], const uint32_t src_linesize[], uint8_t* const dst[],
+			          const int dst_linesize[], frame_analysis* analysis = nullptr);
+
+			bool is_streaming();
+
+			// Frames larger than this are copied with non-temporal stores, zero picks the size of the last
+			// level cache. Only takes effect on the next initialize().
+			void set_streaming_threshold(size_t bytes);
+
+			const char* get_kernel_name();
+
+			size_t get_stripe_count();
+		};
+	} // namespace convert
+} // namespace obsffmpeg
@@ -0,0 +1,288 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Repacking between YUV layouts that share the same sampling, which is nothing but moving bytes around.
+
+#include "converter.hpp"
+
+using namespace obsffmpeg::convert;
+
+//------------------------------------------------------------------------------
+// NV12 -> I420
+//------------------------------------------------------------------------------
+static inline void deinterleave_c(const uint8_t* uv, uint8_t* u, uint8_t* v, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		u[x] = uv[x * 2];
+		v[x] = uv[x * 2 + 1];
+	}
+}
+
+static int deinterleave_none(const uint8_t*, uint8_t*, uint8_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSSE3 static int deinterleave_ssse3(const uint8_t* uv, uint8_t* u, uint8_t* v, int count)
+{
+	const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2)), split);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2 + 16)), split);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), _mm_unpacklo_epi64(a, b));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(v + x), _mm_unpackhi_epi64(a, b));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int deinterleave_avx2(const uint8_t* uv, uint8_t* u, uint8_t* v, int count)
+{
+	const __m256i split = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8,
+	                                       10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+	int x = 0;
+	for (; x + 32 <= count; x += 32) {
+		const __m256i* in = reinterpret_cast<const __m256i*>(uv + x * 2);
+		__m256i        a  = _mm256_shuffle_epi8(_mm256_loadu_si256(in), split);
+		__m256i        b  = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 1), split);
+		// Lanes are [U V] each, unpacking and reordering the 64-bit quarters gives 32 consecutive samples.
+		__m256i us = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+		__m256i vs = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(u + x), us);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(v + x), vs);
+	}
+	return x;
+}
+#endif
+
+template<int (*Simd)(const uint8_t*, uint8_t*, uint8_t*, int)>
+static void nv12_to_i420(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	copy_rows(src[0], src_linesize[0], dst[0], dst_linesize[0], ctx.width, row_begin, row_end);
+
+	int chroma_width = (ctx.width + 1) / 2;
+	for (int y = row_begin / 2; y < (row_end + 1) / 2; y++) {
+		const uint8_t* uv = src[1] + static_cast<ptrdiff_t>(src_linesize[1]) * y;
+		uint8_t*       u  = dst[1] + static_cast<ptrdiff_t>(dst_linesize[1]) * y;
+		uint8_t*       v  = dst[2] + static_cast<ptrdiff_t>(dst_linesize[2]) * y;
+		int            x  = Simd(uv, u, v, chroma_width);
+		deinterleave_c(uv, u, v, x, chroma_width);
+	}
+}
+
+//------------------------------------------------------------------------------
+// I420 -> NV12
+//------------------------------------------------------------------------------
+static inline void interleave_c(const uint8_t* u, const uint8_t* v, uint8_t* uv, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		uv[x * 2]     = u[x];
+		uv[x * 2 + 1] = v[x];
+	}
+}
+
+static int interleave_none(const uint8_t*, const uint8_t*, uint8_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSE2 static int interleave_sse2(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count)
+{
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i us = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x));
+		__m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x * 2), _mm_unpacklo_epi8(us, vs));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x * 2 + 16), _mm_unpackhi_epi8(us, vs));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int interleave_avx2(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count)
+{
+	int x = 0;
+	for (; x + 32 <= count; x += 32) {
+		__m256i us = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + x));
+		__m256i vs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + x));
+		__m256i lo = _mm256_unpacklo_epi8(us, vs);
+		__m256i hi = _mm256_unpackhi_epi8(us, vs);
+		__m256i* out = reinterpret_cast<__m256i*>(uv + x * 2);
+		_mm256_storeu_si256(out, _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return x;
+}
+#endif
+
+template<int (*Simd)(const uint8_t*, const uint8_t*, uint8_t*, int)>
+static void i420_to_nv12(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	copy_rows(src[0], src_linesize[0], dst[0], dst_linesize[0], ctx.width, row_begin, row_end);
+
+	int chroma_width = (ctx.width + 1) / 2;
+	for (int y = row_begin / 2; y < (row_end + 1) / 2; y++) {
+		const uint8_t* u  = src[1] + static_cast<ptrdiff_t>(src_linesize[1]) * y;
+		const uint8_t* v  = src[2] + static_cast<ptrdiff_t>(src_linesize[2]) * y;
+		uint8_t*       uv = dst[1] + static_cast<ptrdiff_t>(dst_linesize[1]) * y;
+		int            x  = Simd(u, v, uv, chroma_width);
+		interleave_c(u, v, uv, x, chroma_width);
+	}
+}
+
+//------------------------------------------------------------------------------
+// YUY2/UYVY/YVYU -> I422
+//------------------------------------------------------------------------------
+// Byte offsets of Y0, U, Y1 and V within a 4 byte macro pixel.
+template<int Y0, int U, int Y1, int V>
+static inline void unpack422_c(const uint8_t* packed, uint8_t* y, uint8_t* u, uint8_t* v, int begin, int width)
+{
+	for (int x = begin; x < width; x += 2) {
+		const uint8_t* px = packed + x * 2;
+		y[x]              = px[Y0];
+		if (x + 1 < width)
+			y[x + 1] = px[Y1];
+		u[x / 2] = px[U];
+		v[x / 2] = px[V];
+	}
+}
+
+static int unpack422_none(const uint8_t*, uint8_t*, uint8_t*, uint8_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+template<int Y0, int U, int Y1, int V>
+OBSFFMPEG_TARGET_SSSE3 static int unpack422_ssse3(const uint8_t* packed, uint8_t* y, uint8_t* u, uint8_t* v,
+                                                  int width)
+{
+	// Gathers [Y x8, U x4, V x4] out of 8 pixels.
+	const __m128i gather  = _mm_setr_epi8(Y0, Y1, 4 + Y0, 4 + Y1, 8 + Y0, 8 + Y1, 12 + Y0, 12 + Y1, U, 4 + U,
+	                                      8 + U, 12 + U, V, 4 + V, 8 + V, 12 + V);
+	const __m128i regroup = _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const __m128i* in = reinterpret_cast<const __m128i*>(packed + x * 2);
+		__m128i        a  = _mm_shuffle_epi8(_mm_loadu_si128(in), gather);
+		__m128i        b  = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), gather);
+		__m128i        uv = _mm_shuffle_epi8(_mm_unpackhi_epi64(a, b), regroup);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), _mm_unpacklo_epi64(a, b));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), uv);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_srli_si128(uv, 8));
+	}
+	return x;
+}
+
+template<int Y0, int U, int Y1, int V>
+OBSFFMPEG_TARGET_AVX2 static int unpack422_avx2(const uint8_t* packed, uint8_t* y, uint8_t* u, uint8_t* v,
+                                                int width)
+{
+	const __m256i gather  = _mm256_setr_epi8(Y0, Y1, 4 + Y0, 4 + Y1, 8 + Y0, 8 + Y1, 12 + Y0, 12 + Y1, U, 4 + U,
+	                                         8 + U, 12 + U, V, 4 + V, 8 + V, 12 + V, Y0, Y1, 4 + Y0, 4 + Y1,
+	                                         8 + Y0, 8 + Y1, 12 + Y0, 12 + Y1, U, 4 + U, 8 + U, 12 + U, V,
+	                                         4 + V, 8 + V, 12 + V);
+	const __m256i regroup = _mm256_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15, 0, 1, 2, 3, 8,
+	                                         9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32) {
+		const __m256i* in = reinterpret_cast<const __m256i*>(packed + x * 2);
+		__m256i        a  = _mm256_shuffle_epi8(_mm256_loadu_si256(in), gather);
+		__m256i        b  = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 1), gather);
+
+		// Each lane holds [Y x8, U x4, V x4], reorder the 64-bit quarters back into pixel order.
+		__m256i ys = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+		__m256i uv = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+		uv         = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(uv, regroup), 0xD8);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), ys);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x / 2), _mm256_castsi256_si128(uv));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(v + x / 2), _mm256_extracti128_si256(uv, 1));
+	}
+	return x;
+}
+#endif
+
+template<int Y0, int U, int Y1, int V, int (*Simd)(const uint8_t*, uint8_t*, uint8_t*, uint8_t*, int)>
+static void packed422_to_i422(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                              uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	for (int row = row_begin; row < row_end; row++) {
+		const uint8_t* packed = src[0] + static_cast<ptrdiff_t>(src_linesize[0]) * row;
+		uint8_t*       y      = dst[0] + static_cast<ptrdiff_t>(dst_linesize[0]) * row;
+		uint8_t*       u      = dst[1] + static_cast<ptrdiff_t>(dst_linesize[1]) * row;
+		uint8_t*       v      = dst[2] + static_cast<ptrdiff_t>(dst_linesize[2]) * row;
+		int            x      = Simd(packed, y, u, v, ctx.width);
+		unpack422_c<Y0, U, Y1, V>(packed, y, u, v, x, ctx.width);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Registration
+//------------------------------------------------------------------------------
+#define ORDER_YUYV 0, 1, 2, 3
+#define ORDER_UYVY 1, 0, 3, 2
+#define ORDER_YVYU 0, 3, 2, 1
+
+void obsffmpeg::convert::register_repack_kernels(std::vector<kernel_info>& kernels)
+{
+	kernels.push_back({AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P, simd_level::NONE, "NV12 to I420 (C)",
+	                   nv12_to_i420<deinterleave_none>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, simd_level::NONE, "I420 to NV12 (C)",
+	                   i420_to_nv12<interleave_none>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV422P, simd_level::NONE, "YUY2 to I422 (C)",
+	                   packed422_to_i422<ORDER_YUYV, unpack422_none>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_UYVY422, AV_PIX_FMT_YUV422P, simd_level::NONE, "UYVY to I422 (C)",
+	                   packed422_to_i422<ORDER_UYVY, unpack422_none>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YVYU422, AV_PIX_FMT_YUV422P, simd_level::NONE, "YVYU to I422 (C)",
+	                   packed422_to_i422<ORDER_YVYU, unpack422_none>, nullptr, 1});
+
+#ifdef OBSFFMPEG_SIMD_X86
+	kernels.push_back({AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P, simd_level::SSSE3, "NV12 to I420 (SSSE3)",
+	                   nv12_to_i420<deinterleave_ssse3>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P, simd_level::AVX2, "NV12 to I420 (AVX2)",
+	                   nv12_to_i420<deinterleave_avx2>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, simd_level::SSE2, "I420 to NV12 (SSE2)",
+	                   i420_to_nv12<interleave_sse2>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, simd_level::AVX2, "I420 to NV12 (AVX2)",
+	                   i420_to_nv12<interleave_avx2>, nullptr, 2});
+	kernels.push_back({AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV422P, simd_level::SSSE3, "YUY2 to I422 (SSSE3)",
+	                   packed422_to_i422<ORDER_YUYV, unpack422_ssse3<ORDER_YUYV>>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV422P, simd_level::AVX2, "YUY2 to I422 (AVX2)",
+	                   packed422_to_i422<ORDER_YUYV, unpack422_avx2<ORDER_YUYV>>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_UYVY422, AV_PIX_FMT_YUV422P, simd_level::SSSE3, "UYVY to I422 (SSSE3)",
+	                   packed422_to_i422<ORDER_UYVY, unpack422_ssse3<ORDER_UYVY>>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_UYVY422, AV_PIX_FMT_YUV422P, simd_level::AVX2, "UYVY to I422 (AVX2)",
+	                   packed422_to_i422<ORDER_UYVY, unpack422_avx2<ORDER_UYVY>>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YVYU422, AV_PIX_FMT_YUV422P, simd_level::SSSE3, "YVYU to I422 (SSSE3)",
+	                   packed422_to_i422<ORDER_YVYU, unpack422_ssse3<ORDER_YVYU>>, nullptr, 1});
+	kernels.push_back({AV_PIX_FMT_YVYU422, AV_PIX_FMT_YUV422P, simd_level::AVX2, "YVYU to I422 (AVX2)",
+	                   packed422_to_i422<ORDER_YVYU, unpack422_avx2<ORDER_YVYU>>, nullptr, 1});
+#endif
+}
@@ -0,0 +1,566 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// RGB to YUV matrix conversion for the 32-bit RGB formats OBS outputs.
+// Every variant uses the same fixed point math, so the SIMD kernels produce exactly the same output as the C ones.
+// 8-bit targets use Q15 coefficients, 10-bit targets use Q13 so that the larger coefficients still fit in 16 bits.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "converter.hpp"
+
+using namespace obsffmpeg::convert;
+
+static constexpr int fraction_bits    = 15;
+static constexpr int fraction_bits_10 = 13;
+
+// Layout of kernel_context::coefficients, each row is in R, G, B order.
+static constexpr int coefficients_y = 0;
+static constexpr int coefficients_u = 3;
+static constexpr int coefficients_v = 6;
+
+enum class yuv_layout {
+	I420,
+	NV12,
+	I444,
+};
+
+static bool prepare_matrix(kernel_context& ctx, bool target_full_range, AVColorSpace target_colorspace, int depth,
+                           int fraction_bits)
+{
+	double kr, kb;
+	switch (target_colorspace) {
+	case AVCOL_SPC_BT470BG:
+	case AVCOL_SPC_SMPTE170M:
+		kr = 0.299;
+		kb = 0.114;
+		break;
+	case AVCOL_SPC_BT709:
+		kr = 0.2126;
+		kb = 0.0722;
+		break;
+	default:
+		return false;
+	}
+	double kg = 1.0 - kr - kb;
+
+	// Partial range is 219 (luma) and 224 (chroma) steps of 8-bit, scaled up for deeper targets.
+	double full    = static_cast<double>((1 << depth) - 1) / 255.0;
+	double y_scale = target_full_range ? full : (static_cast<double>(219 << (depth - 8)) / 255.0);
+	double c_scale = target_full_range ? full : (static_cast<double>(224 << (depth - 8)) / 255.0);
+	double u_scale = c_scale / (2.0 * (1.0 - kb));
+	double v_scale = c_scale / (2.0 * (1.0 - kr));
+
+	double matrix[9] = {
+	    kr * y_scale,  kg * y_scale,   kb * y_scale,  // Y
+	    -kr * u_scale, -kg * u_scale,  0.5 * c_scale, // U
+	    0.5 * c_scale, -kg * v_scale,  -kb * v_scale, // V
+	};
+	for (size_t idx = 0; idx < 9; idx++) {
+		ctx.coefficients[idx] = static_cast<int32_t>(std::lround(matrix[idx] * (1 << fraction_bits)));
+	}
+	ctx.full_range = target_full_range;
+	return true;
+}
+
+static bool prepare_rgb(kernel_context& ctx, bool, AVColorSpace, bool target_full_range,
+                        AVColorSpace target_colorspace)
+{
+	return prepare_matrix(ctx, target_full_range, target_colorspace, 8, fraction_bits);
+}
+
+static bool prepare_rgb10(kernel_context& ctx, bool, AVColorSpace, bool target_full_range,
+                          AVColorSpace target_colorspace)
+{
+	return prepare_matrix(ctx, target_full_range, target_colorspace, 10, fraction_bits_10);
+}
+
+// Spreads a row of coefficients onto the byte order of the source, the unused fourth byte gets zero.
+template<int R, int G, int B>
+static inline void load_coefficients(kernel_context const& ctx, int row, int16_t k[4])
+{
+	k[0] = k[1] = k[2] = k[3] = 0;
+	k[R]                      = static_cast<int16_t>(ctx.coefficients[row]);
+	k[G]                      = static_cast<int16_t>(ctx.coefficients[row + 1]);
+	k[B]                      = static_cast<int16_t>(ctx.coefficients[row + 2]);
+}
+
+static inline int64_t splat_coefficients(const int16_t k[4])
+{
+	int64_t v;
+	std::memcpy(&v, k, sizeof(v));
+	return v;
+}
+
+static inline uint8_t clamp_u8(int32_t v)
+{
+	return static_cast<uint8_t>(std::min(std::max(v, 0), 255));
+}
+
+//------------------------------------------------------------------------------
+// Per pixel matrix row (Y, and U/V for 4:4:4)
+//------------------------------------------------------------------------------
+static inline void dot_c(const uint8_t* rgb, uint8_t* out, const int16_t k[4], int32_t offset, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		const uint8_t* px  = rgb + x * 4;
+		int32_t        sum = px[0] * k[0] + px[1] * k[1] + px[2] * k[2] + px[3] * k[3];
+		out[x]             = clamp_u8((sum + offset) >> fraction_bits);
+	}
+}
+
+static int dot_none(const uint8_t*, uint8_t*, const int16_t[4], int32_t, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSSE3 static inline __m128i dot4_ssse3(__m128i px, __m128i k)
+{
+	// Four pixels in, four 32-bit sums out.
+	const __m128i zero = _mm_setzero_si128();
+	__m128i       lo   = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), k);
+	__m128i       hi   = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), k);
+	return _mm_hadd_epi32(lo, hi);
+}
+
+OBSFFMPEG_TARGET_SSSE3 static int dot_ssse3(const uint8_t* rgb, uint8_t* out, const int16_t k[4], int32_t offset,
+                                            int count)
+{
+	const __m128i kv   = _mm_setr_epi16(k[0], k[1], k[2], k[3], k[0], k[1], k[2], k[3]);
+	const __m128i offv = _mm_set1_epi32(offset);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m128i* in = reinterpret_cast<const __m128i*>(rgb + x * 4);
+		__m128i        a  = _mm_add_epi32(dot4_ssse3(_mm_loadu_si128(in), kv), offv);
+		__m128i        b  = _mm_add_epi32(dot4_ssse3(_mm_loadu_si128(in + 1), kv), offv);
+		a                 = _mm_srai_epi32(a, fraction_bits);
+		b                 = _mm_srai_epi32(b, fraction_bits);
+		__m128i res       = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), res);
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static inline __m256i dot8_avx2(__m256i px, __m256i k)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i       lo   = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), k);
+	__m256i       hi   = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), k);
+	return _mm256_hadd_epi32(lo, hi);
+}
+
+OBSFFMPEG_TARGET_AVX2 static int dot_avx2(const uint8_t* rgb, uint8_t* out, const int16_t k[4], int32_t offset,
+                                          int count)
+{
+	const __m256i kv   = _mm256_set1_epi64x(splat_coefficients(k));
+	const __m256i offv = _mm256_set1_epi32(offset);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		const __m256i* in = reinterpret_cast<const __m256i*>(rgb + x * 4);
+		__m256i        a  = _mm256_add_epi32(dot8_avx2(_mm256_loadu_si256(in), kv), offv);
+		__m256i        b  = _mm256_add_epi32(dot8_avx2(_mm256_loadu_si256(in + 1), kv), offv);
+		a                 = _mm256_srai_epi32(a, fraction_bits);
+		b                 = _mm256_srai_epi32(b, fraction_bits);
+		// Packing works per lane, so the quarters have to be put back into pixel order after each step.
+		__m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		__m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm256_castsi256_si128(bytes));
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// 2x2 box filtered chroma (4:2:0)
+//------------------------------------------------------------------------------
+// The average of four pixels puts the chroma sample at the center of them. The sum of the four pixels is used
+// directly, which just needs two more bits of shift.
+template<bool Interleaved>
+static inline void box_c(const uint8_t* rgb0, const uint8_t* rgb1, uint8_t* u, uint8_t* v, const int16_t ku[4],
+                         const int16_t kv[4], int32_t offset, int width, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		int x0 = x * 2;
+		int x1 = std::min(x0 + 1, width - 1);
+
+		int32_t sum_u = 0, sum_v = 0;
+		for (int c = 0; c < 4; c++) {
+			int32_t s = rgb0[x0 * 4 + c] + rgb0[x1 * 4 + c] + rgb1[x0 * 4 + c] + rgb1[x1 * 4 + c];
+			sum_u += s * ku[c];
+			sum_v += s * kv[c];
+		}
+
+		uint8_t cu = clamp_u8((sum_u + offset) >> (fraction_bits + 2));
+		uint8_t cv = clamp_u8((sum_v + offset) >> (fraction_bits + 2));
+		if (Interleaved) {
+			u[x * 2]     = cu;
+			u[x * 2 + 1] = cv;
+		} else {
+			u[x] = cu;
+			v[x] = cv;
+		}
+	}
+}
+
+template<bool Interleaved>
+static int box_none(const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, const int16_t[4], const int16_t[4],
+                    int32_t, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSSE3 static inline __m128i box2_ssse3(__m128i row0, __m128i row1)
+{
+	// Four pixels of each row in, the per channel sums of two 2x2 blocks out.
+	const __m128i zero = _mm_setzero_si128();
+	__m128i       lo   = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+	__m128i       hi   = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+	return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+}
+
+template<bool Interleaved>
+OBSFFMPEG_TARGET_SSSE3 static int box_ssse3(const uint8_t* rgb0, const uint8_t* rgb1, uint8_t* u, uint8_t* v,
+                                            const int16_t ku[4], const int16_t kv[4], int32_t offset, int count)
+{
+	const __m128i kuv  = _mm_setr_epi16(ku[0], ku[1], ku[2], ku[3], ku[0], ku[1], ku[2], ku[3]);
+	const __m128i kvv  = _mm_setr_epi16(kv[0], kv[1], kv[2], kv[3], kv[0], kv[1], kv[2], kv[3]);
+	const __m128i offv = _mm_set1_epi32(offset);
+
+	int x = 0;
+	for (; x + 4 <= count; x += 4) {
+		const __m128i* in0 = reinterpret_cast<const __m128i*>(rgb0 + x * 8);
+		const __m128i* in1 = reinterpret_cast<const __m128i*>(rgb1 + x * 8);
+		__m128i        a   = box2_ssse3(_mm_loadu_si128(in0), _mm_loadu_si128(in1));
+		__m128i        b   = box2_ssse3(_mm_loadu_si128(in0 + 1), _mm_loadu_si128(in1 + 1));
+
+		__m128i us = _mm_hadd_epi32(_mm_madd_epi16(a, kuv), _mm_madd_epi16(b, kuv));
+		__m128i vs = _mm_hadd_epi32(_mm_madd_epi16(a, kvv), _mm_madd_epi16(b, kvv));
+		us         = _mm_srai_epi32(_mm_add_epi32(us, offv), fraction_bits + 2);
+		vs         = _mm_srai_epi32(_mm_add_epi32(vs, offv), fraction_bits + 2);
+
+		// [U0 U1 U2 U3 V0 V1 V2 V3]
+		__m128i res = _mm_packus_epi16(_mm_packs_epi32(us, vs), _mm_setzero_si128());
+		if (Interleaved) {
+			__m128i uv = _mm_unpacklo_epi8(res, _mm_srli_si128(res, 4));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x * 2), uv);
+		} else {
+			int32_t uw = _mm_cvtsi128_si32(res);
+			int32_t vw = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+			std::memcpy(u + x, &uw, sizeof(uw));
+			std::memcpy(v + x, &vw, sizeof(vw));
+		}
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static inline __m256i box2_avx2(__m256i row0, __m256i row1)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i       lo   = _mm256_add_epi16(_mm256_unpacklo_epi8(row0, zero), _mm256_unpacklo_epi8(row1, zero));
+	__m256i       hi   = _mm256_add_epi16(_mm256_unpackhi_epi8(row0, zero), _mm256_unpackhi_epi8(row1, zero));
+	return _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+}
+
+template<bool Interleaved>
+OBSFFMPEG_TARGET_AVX2 static int box_avx2(const uint8_t* rgb0, const uint8_t* rgb1, uint8_t* u, uint8_t* v,
+                                          const int16_t ku[4], const int16_t kv[4], int32_t offset, int count)
+{
+	const __m256i kuv   = _mm256_set1_epi64x(splat_coefficients(ku));
+	const __m256i kvv   = _mm256_set1_epi64x(splat_coefficients(kv));
+	const __m256i offv  = _mm256_set1_epi32(offset);
+	const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m256i* in0 = reinterpret_cast<const __m256i*>(rgb0 + x * 8);
+		const __m256i* in1 = reinterpret_cast<const __m256i*>(rgb1 + x * 8);
+		__m256i        a   = box2_avx2(_mm256_loadu_si256(in0), _mm256_loadu_si256(in1));
+		__m256i        b   = box2_avx2(_mm256_loadu_si256(in0 + 1), _mm256_loadu_si256(in1 + 1));
+
+		// The horizontal add works per lane and leaves [0 1 4 5 | 2 3 6 7], restore the order right away.
+		__m256i us = _mm256_hadd_epi32(_mm256_madd_epi16(a, kuv), _mm256_madd_epi16(b, kuv));
+		__m256i vs = _mm256_hadd_epi32(_mm256_madd_epi16(a, kvv), _mm256_madd_epi16(b, kvv));
+		us         = _mm256_srai_epi32(_mm256_add_epi32(us, offv), fraction_bits + 2);
+		vs         = _mm256_srai_epi32(_mm256_add_epi32(vs, offv), fraction_bits + 2);
+		us         = _mm256_permutevar8x32_epi32(us, order);
+		vs         = _mm256_permutevar8x32_epi32(vs, order);
+
+		// [U0..U7 x2 | V0..V7 x2]
+		__m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(us, vs), 0xD8);
+		__m256i bytes = _mm256_packus_epi16(words, words);
+		__m128i ub    = _mm256_castsi256_si128(bytes);
+		__m128i vb    = _mm256_extracti128_si256(bytes, 1);
+		if (Interleaved) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x * 2), _mm_unpacklo_epi8(ub, vb));
+		} else {
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x), ub);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(v + x), vb);
+		}
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// 10-bit per pixel matrix row and alpha
+//------------------------------------------------------------------------------
+static inline void dot10_c(const uint8_t* rgb, uint16_t* out, const int16_t k[4], int32_t offset, int begin,
+                           int end)
+{
+	for (int x = begin; x < end; x++) {
+		const uint8_t* px  = rgb + x * 4;
+		int32_t        sum = px[0] * k[0] + px[1] * k[1] + px[2] * k[2] + px[3] * k[3];
+		out[x] = static_cast<uint16_t>(std::min(std::max((sum + offset) >> fraction_bits_10, 0), 1023));
+	}
+}
+
+// Alpha is always full range, so it widens the same way as full range video.
+static inline void alpha10_c(const uint8_t* rgb, uint16_t* out, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		uint8_t a = rgb[x * 4 + 3];
+		out[x]    = static_cast<uint16_t>((a << 2) | (a >> 6));
+	}
+}
+
+static int dot10_none(const uint8_t*, uint16_t*, const int16_t[4], int32_t, int)
+{
+	return 0;
+}
+
+static int alpha10_none(const uint8_t*, uint16_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSSE3 static int dot10_ssse3(const uint8_t* rgb, uint16_t* out, const int16_t k[4], int32_t offset,
+                                              int count)
+{
+	const __m128i kv   = _mm_setr_epi16(k[0], k[1], k[2], k[3], k[0], k[1], k[2], k[3]);
+	const __m128i offv = _mm_set1_epi32(offset);
+	const __m128i maxv = _mm_set1_epi16(1023);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m128i* in = reinterpret_cast<const __m128i*>(rgb + x * 4);
+		__m128i        a  = _mm_add_epi32(dot4_ssse3(_mm_loadu_si128(in), kv), offv);
+		__m128i        b  = _mm_add_epi32(dot4_ssse3(_mm_loadu_si128(in + 1), kv), offv);
+		a                 = _mm_srai_epi32(a, fraction_bits_10);
+		b                 = _mm_srai_epi32(b, fraction_bits_10);
+		__m128i res       = _mm_packs_epi32(a, b);
+		res               = _mm_min_epi16(_mm_max_epi16(res, _mm_setzero_si128()), maxv);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), res);
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_SSE2 static int alpha10_sse2(const uint8_t* rgb, uint16_t* out, int count)
+{
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		const __m128i* in = reinterpret_cast<const __m128i*>(rgb + x * 4);
+		__m128i        a  = _mm_srli_epi32(_mm_loadu_si128(in), 24);
+		__m128i        b  = _mm_srli_epi32(_mm_loadu_si128(in + 1), 24);
+		__m128i        v  = _mm_packs_epi32(a, b);
+		v                 = _mm_or_si128(_mm_slli_epi16(v, 2), _mm_srli_epi16(v, 6));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), v);
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int dot10_avx2(const uint8_t* rgb, uint16_t* out, const int16_t k[4], int32_t offset,
+                                            int count)
+{
+	const __m256i kv   = _mm256_set1_epi64x(splat_coefficients(k));
+	const __m256i offv = _mm256_set1_epi32(offset);
+	const __m256i maxv = _mm256_set1_epi16(1023);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		const __m256i* in = reinterpret_cast<const __m256i*>(rgb + x * 4);
+		__m256i        a  = _mm256_add_epi32(dot8_avx2(_mm256_loadu_si256(in), kv), offv);
+		__m256i        b  = _mm256_add_epi32(dot8_avx2(_mm256_loadu_si256(in + 1), kv), offv);
+		a                 = _mm256_srai_epi32(a, fraction_bits_10);
+		b                 = _mm256_srai_epi32(b, fraction_bits_10);
+		__m256i res       = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		res               = _mm256_min_epi16(_mm256_max_epi16(res, _mm256_setzero_si256()), maxv);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), res);
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int alpha10_avx2(const uint8_t* rgb, uint16_t* out, int count)
+{
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		const __m256i* in = reinterpret_cast<const __m256i*>(rgb + x * 4);
+		__m256i        a  = _mm256_srli_epi32(_mm256_loadu_si256(in), 24);
+		__m256i        b  = _mm256_srli_epi32(_mm256_loadu_si256(in + 1), 24);
+		__m256i        v  = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		v                 = _mm256_or_si256(_mm256_slli_epi16(v, 2), _mm256_srli_epi16(v, 6));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), v);
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Kernels
+//------------------------------------------------------------------------------
+typedef int (*dot_t)(const uint8_t*, uint8_t*, const int16_t[4], int32_t, int);
+typedef int (*box_t)(const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, const int16_t[4], const int16_t[4], int32_t,
+                     int);
+typedef int (*dot10_t)(const uint8_t*, uint16_t*, const int16_t[4], int32_t, int);
+typedef int (*alpha10_t)(const uint8_t*, uint16_t*, int);
+
+template<int R, int G, int B, yuv_layout Layout, dot_t Dot, box_t Box>
+static void rgb_to_yuv(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                       uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	int16_t ky[4], ku[4], kv[4];
+	load_coefficients<R, G, B>(ctx, coefficients_y, ky);
+	load_coefficients<R, G, B>(ctx, coefficients_u, ku);
+	load_coefficients<R, G, B>(ctx, coefficients_v, kv);
+
+	const int32_t round     = 1 << (fraction_bits - 1);
+	const int32_t y_offset  = ((ctx.full_range ? 0 : 16) << fraction_bits) + round;
+	const int32_t uv_offset = (128 << fraction_bits) + round;
+
+	for (int row = row_begin; row < row_end; row++) {
+		const uint8_t* rgb = src[0] + static_cast<ptrdiff_t>(src_linesize[0]) * row;
+		uint8_t*       y   = dst[0] + static_cast<ptrdiff_t>(dst_linesize[0]) * row;
+		dot_c(rgb, y, ky, y_offset, Dot(rgb, y, ky, y_offset, ctx.width), ctx.width);
+
+		if (Layout == yuv_layout::I444) {
+			uint8_t* u = dst[1] + static_cast<ptrdiff_t>(dst_linesize[1]) * row;
+			uint8_t* v = dst[2] + static_cast<ptrdiff_t>(dst_linesize[2]) * row;
+			dot_c(rgb, u, ku, uv_offset, Dot(rgb, u, ku, uv_offset, ctx.width), ctx.width);
+			dot_c(rgb, v, kv, uv_offset, Dot(rgb, v, kv, uv_offset, ctx.width), ctx.width);
+		} else if ((row & 1) == 0) {
+			// The last row of an odd height frame is paired with itself.
+			int            next  = std::min(row + 1, ctx.height - 1);
+			const uint8_t* rgb1  = src[0] + static_cast<ptrdiff_t>(src_linesize[0]) * next;
+			int            count = (ctx.width + 1) / 2;
+
+			uint8_t* u = dst[1] + static_cast<ptrdiff_t>(dst_linesize[1]) * (row / 2);
+			uint8_t* v = nullptr;
+			if (Layout != yuv_layout::NV12)
+				v = dst[2] + static_cast<ptrdiff_t>(dst_linesize[2]) * (row / 2);
+
+			// Only complete pairs of pixels go through the vectorized path.
+			int x = Box(rgb, rgb1, u, v, ku, kv, uv_offset << 2, ctx.width / 2);
+			box_c<Layout == yuv_layout::NV12>(rgb, rgb1, u, v, ku, kv, uv_offset << 2, ctx.width, x, count);
+		}
+	}
+}
+
+// Matrix, alpha and widening in one pass over each row, for ProRes 4444.
+template<int R, int G, int B, bool Alpha, dot10_t Dot, alpha10_t Extract>
+static void rgb_to_yuva444p10(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                              uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	int16_t k[3][4];
+	load_coefficients<R, G, B>(ctx, coefficients_y, k[0]);
+	load_coefficients<R, G, B>(ctx, coefficients_u, k[1]);
+	load_coefficients<R, G, B>(ctx, coefficients_v, k[2]);
+
+	const int32_t round     = 1 << (fraction_bits_10 - 1);
+	const int32_t offset[3] = {((ctx.full_range ? 0 : 64) << fraction_bits_10) + round,
+	                           (512 << fraction_bits_10) + round, (512 << fraction_bits_10) + round};
+
+	for (int row = row_begin; row < row_end; row++) {
+		const uint8_t* rgb = src[0] + static_cast<ptrdiff_t>(src_linesize[0]) * row;
+		for (size_t plane = 0; plane < 3; plane++) {
+			uint8_t*  line = dst[plane] + static_cast<ptrdiff_t>(dst_linesize[plane]) * row;
+			uint16_t* out  = reinterpret_cast<uint16_t*>(line);
+			int       x    = Dot(rgb, out, k[plane], offset[plane], ctx.width);
+			dot10_c(rgb, out, k[plane], offset[plane], x, ctx.width);
+		}
+
+		uint16_t* a = reinterpret_cast<uint16_t*>(dst[3] + static_cast<ptrdiff_t>(dst_linesize[3]) * row);
+		if (Alpha) {
+			alpha10_c(rgb, a, Extract(rgb, a, ctx.width), ctx.width);
+		} else {
+			std::fill(a, a + ctx.width, static_cast<uint16_t>(1023));
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Registration
+//------------------------------------------------------------------------------
+// Byte offsets of R, G and B in each source format.
+#define ORDER_RGBA 0, 1, 2
+#define ORDER_BGRA 2, 1, 0
+
+#define ADD_KERNELS(SOURCE, ORDER, NAME, LEVEL, SUFFIX, DOT, BOX) \
+	kernels.push_back({SOURCE, AV_PIX_FMT_YUV420P, LEVEL, NAME " to I420 " SUFFIX, \
+	                   rgb_to_yuv<ORDER, yuv_layout::I420, DOT, BOX<false>>, prepare_rgb, 2}); \
+	kernels.push_back({SOURCE, AV_PIX_FMT_NV12, LEVEL, NAME " to NV12 " SUFFIX, \
+	                   rgb_to_yuv<ORDER, yuv_layout::NV12, DOT, BOX<true>>, prepare_rgb, 2}); \
+	kernels.push_back({SOURCE, AV_PIX_FMT_YUV444P, LEVEL, NAME " to I444 " SUFFIX, \
+	                   rgb_to_yuv<ORDER, yuv_layout::I444, DOT, BOX<false>>, prepare_rgb, 1});
+
+#define ADD_ALPHA_KERNELS(SOURCE, ORDER, ALPHA, NAME, LEVEL, SUFFIX, DOT, EXTRACT) \
+	kernels.push_back({SOURCE, AV_PIX_FMT_YUVA444P10, LEVEL, NAME " to YUVA444P10 " SUFFIX, \
+	                   rgb_to_yuva444p10<ORDER, ALPHA, DOT, EXTRACT>, prepare_rgb10, 1});
+
+void obsffmpeg::convert::register_rgb_kernels(std::vector<kernel_info>& kernels)
+{
+	ADD_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, "RGBA", simd_level::NONE, "(C)", dot_none, box_none);
+	ADD_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, "BGRA", simd_level::NONE, "(C)", dot_none, box_none);
+	ADD_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, "BGRX", simd_level::NONE, "(C)", dot_none, box_none);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, true, "RGBA", simd_level::NONE, "(C)", dot10_none,
+	                  alpha10_none);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, true, "BGRA", simd_level::NONE, "(C)", dot10_none,
+	                  alpha10_none);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, false, "BGRX", simd_level::NONE, "(C)", dot10_none,
+	                  alpha10_none);
+
+#ifdef OBSFFMPEG_SIMD_X86
+	ADD_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, "RGBA", simd_level::SSSE3, "(SSSE3)", dot_ssse3, box_ssse3);
+	ADD_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, "BGRA", simd_level::SSSE3, "(SSSE3)", dot_ssse3, box_ssse3);
+	ADD_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, "BGRX", simd_level::SSSE3, "(SSSE3)", dot_ssse3, box_ssse3);
+	ADD_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, "RGBA", simd_level::AVX2, "(AVX2)", dot_avx2, box_avx2);
+	ADD_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, "BGRA", simd_level::AVX2, "(AVX2)", dot_avx2, box_avx2);
+	ADD_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, "BGRX", simd_level::AVX2, "(AVX2)", dot_avx2, box_avx2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, true, "RGBA", simd_level::SSSE3, "(SSSE3)", dot10_ssse3,
+	                  alpha10_sse2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, true, "BGRA", simd_level::SSSE3, "(SSSE3)", dot10_ssse3,
+	                  alpha10_sse2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, false, "BGRX", simd_level::SSSE3, "(SSSE3)", dot10_ssse3,
+	                  alpha10_sse2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_RGBA, ORDER_RGBA, true, "RGBA", simd_level::AVX2, "(AVX2)", dot10_avx2,
+	                  alpha10_avx2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGRA, ORDER_BGRA, true, "BGRA", simd_level::AVX2, "(AVX2)", dot10_avx2,
+	                  alpha10_avx2);
+	ADD_ALPHA_KERNELS(AV_PIX_FMT_BGR0, ORDER_BGRA, false, "BGRX", simd_level::AVX2, "(AVX2)", dot10_avx2,
+	                  alpha10_avx2);
+#endif
+}
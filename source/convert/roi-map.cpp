@@ -0,0 +1,163 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "roi-map.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/rational.h>
+#include <libavutil/version.h>
+#pragma warning(pop)
+}
+
+// Region of interest side data was added in FFmpeg 4.2.
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 29, 100)
+#define HAVE_ROI
+#endif
+
+// Encoders walk the region list for every block, so don't hand them an unbounded number of regions.
+static constexpr size_t max_regions = 128;
+
+obsffmpeg::convert::roi_map::roi_map() : _width(0), _height(0), _strength(0), _block_size(frame_analysis::block_size)
+{}
+
+void obsffmpeg::convert::roi_map::initialize(int width, int height, int strength)
+{
+	_width    = width;
+	_height   = height;
+	_strength = std::max(0, std::min(strength, 100));
+	_regions.reserve(max_regions + 1);
+}
+
+bool obsffmpeg::convert::roi_map::is_valid()
+{
+	return is_supported() && (_strength > 0) && (_width > 0) && (_height > 0);
+}
+
+void obsffmpeg::convert::roi_map::build_exact(const frame_analysis_data* data)
+{
+	// Runs of changed blocks are merged with the run directly above them if both span the same columns. Open
+	// regions are kept sorted by column, so matching them up is a single walk per row.
+	_regions.clear();
+	_open.clear();
+	for (uint32_t y = 0; y < data->blocks_y; y++) {
+		size_t open_idx = 0;
+		_next.clear();
+
+		for (uint32_t x = 0; x < data->blocks_x; x++) {
+			if (!data->is_changed(x, y))
+				continue;
+
+			uint32_t x0 = x;
+			while ((x < data->blocks_x) && data->is_changed(x, y))
+				x++;
+
+			while ((open_idx < _open.size()) && (_regions[_open[open_idx]].x0 < x0))
+				open_idx++;
+
+			if ((open_idx < _open.size()) && (_regions[_open[open_idx]].x0 == x0)
+			    && (_regions[_open[open_idx]].x1 == x)) {
+				_regions[_open[open_idx]].y1 = y + 1;
+				_next.push_back(_open[open_idx]);
+				open_idx++;
+			} else {
+				_regions.push_back({x0, x, y, y + 1});
+				_next.push_back(_regions.size() - 1);
+			}
+
+			if (_regions.size() > max_regions)
+				return;
+		}
+
+		std::swap(_open, _next);
+	}
+}
+
+void obsffmpeg::convert::roi_map::build_rows(const frame_analysis_data* data)
+{
+	// Too scattered for exact regions, settle for the span of changed blocks in each row.
+	_regions.clear();
+	for (uint32_t y = 0; y < data->blocks_y; y++) {
+		uint32_t x0 = data->blocks_x, x1 = 0;
+		for (uint32_t x = 0; x < data->blocks_x; x++) {
+			if (data->is_changed(x, y)) {
+				x0 = std::min(x0, x);
+				x1 = x + 1;
+			}
+		}
+		if (x1 == 0)
+			continue;
+
+		if (!_regions.empty() && (_regions.back().y1 == y) && (_regions.back().x0 == x0)
+		    && (_regions.back().x1 == x1)) {
+			_regions.back().y1 = y + 1;
+		} else {
+			_regions.push_back({x0, x1, y, y + 1});
+		}
+	}
+}
+
+void obsffmpeg::convert::roi_map::apply(AVFrame* frame, const frame_analysis_data* data)
+{
+#ifdef HAVE_ROI
+	av_frame_remove_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+
+	if (!data || data->first || (data->changed_blocks == 0)
+	    || (data->changed_blocks == (data->blocks_x * data->blocks_y)))
+		return;
+
+	build_exact(data);
+	if (_regions.size() > max_regions)
+		build_rows(data);
+
+	AVFrameSideData* side = av_frame_new_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST,
+	                                               static_cast<int>(_regions.size() * sizeof(AVRegionOfInterest)));
+	if (!side)
+		throw std::runtime_error("Failed to allocate region of interest side data.");
+
+	// Negative offsets raise the quality, rate control takes the bits from everything else.
+	auto rois = reinterpret_cast<AVRegionOfInterest*>(side->data);
+	for (size_t idx = 0; idx < _regions.size(); idx++) {
+		const region& r     = _regions[idx];
+		rois[idx].self_size = sizeof(AVRegionOfInterest);
+		rois[idx].left      = static_cast<int>(r.x0 * _block_size);
+		rois[idx].right     = std::min(static_cast<int>(r.x1 * _block_size), _width);
+		rois[idx].top       = static_cast<int>(r.y0 * _block_size);
+		rois[idx].bottom    = std::min(static_cast<int>(r.y1 * _block_size), _height);
+		rois[idx].qoffset   = av_make_q(-_strength, 100);
+	}
+#else
+	(void)frame;
+	(void)data;
+#endif
+}
+
+bool obsffmpeg::convert::roi_map::is_supported()
+{
+#ifdef HAVE_ROI
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,72 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include <cinttypes>
+#include <vector>
+#include "frame-analysis.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/frame.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	namespace convert {
+		// Turns the change map of a frame analysis into AV_FRAME_DATA_REGIONS_OF_INTEREST side data, so that
+		// encoders honouring it spend their bits on the parts of the frame that actually change.
+		class roi_map {
+			struct region {
+				uint32_t x0, x1;
+				uint32_t y0, y1;
+			};
+
+			int      _width;
+			int      _height;
+			int      _strength;
+			uint32_t _block_size;
+
+			std::vector<region> _regions;
+			std::vector<size_t> _open;
+			std::vector<size_t> _next;
+
+			void build_exact(const frame_analysis_data* data);
+			void build_rows(const frame_analysis_data* data);
+
+			public:
+			roi_map();
+
+			// Strength is the quality offset given to changed regions in percent, 0 disables the map.
+			void initialize(int width, int height, int strength);
+
+			bool is_valid();
+
+			// Replaces any region of interest side data on the frame, nothing is attached if the change map
+			// would not make a difference (first frame, nothing or everything changed).
+			void apply(AVFrame* frame, const frame_analysis_data* data);
+
+			// Returns false if the linked FFmpeg has no region of interest support.
+			static bool is_supported();
+		};
+	} // namespace convert
+} // namespace obsffmpeg
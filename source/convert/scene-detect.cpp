@@ -0,0 +1,248 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "scene-detect.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include "simd.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixdesc.h>
+#pragma warning(pop)
+}
+
+// Time we are willing to spend per frame. Rows are sampled further apart if the average over a window exceeds it.
+static constexpr int64_t  budget_us      = 250;
+static constexpr uint64_t budget_window  = 60;
+static constexpr size_t   max_row_stride = 64;
+
+// A cut also has to stand out from the recent average difference, so that fast motion doesn't count as one.
+static constexpr double_t average_ratio  = 3.0;
+static constexpr double_t average_weight = 0.1;
+
+static uint64_t sad_c(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	uint64_t sum = 0;
+	for (size_t idx = 0; idx < size; idx++) {
+		sum += static_cast<uint64_t>(std::abs(static_cast<int>(a[idx]) - static_cast<int>(b[idx])));
+	}
+	return sum;
+}
+
+// Averages runs of obsffmpeg::convert::scene_detect::decimation samples.
+static void decimate_c(uint8_t* dst, const uint8_t* src, size_t cols, size_t step)
+{
+	const size_t decimation = obsffmpeg::convert::scene_detect::decimation;
+	for (size_t x = 0; x < cols; x++, src += decimation * step) {
+		uint32_t sum = 0;
+		for (size_t idx = 0; idx < decimation; idx++) {
+			sum += src[idx * step];
+		}
+		dst[x] = static_cast<uint8_t>(sum / decimation);
+	}
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+// Only for tightly packed samples, the SAD against zero sums up eight of them at once.
+OBSFFMPEG_TARGET_SSE2 static void decimate_sse2(uint8_t* dst, const uint8_t* src, size_t cols)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t x = 0;
+	for (; (x + 2) <= cols; x += 2, src += 16) {
+		__m128i sums = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), zero);
+		sums         = _mm_srli_epi64(sums, 3);
+		dst[x]       = static_cast<uint8_t>(_mm_cvtsi128_si32(sums));
+		dst[x + 1]   = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+	}
+	decimate_c(dst + x, src, cols - x, 1);
+}
+
+OBSFFMPEG_TARGET_SSE2 static uint64_t sad_sse2(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	__m128i acc = _mm_setzero_si128();
+	size_t  idx = 0;
+	for (; (idx + 16) <= size; idx += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + idx));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + idx));
+		acc        = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+	}
+
+	uint64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+	return lanes[0] + lanes[1] + sad_c(a + idx, b + idx, size - idx);
+}
+
+OBSFFMPEG_TARGET_AVX2 static uint64_t sad_avx2(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	__m256i acc = _mm256_setzero_si256();
+	size_t  idx = 0;
+	for (; (idx + 32) <= size; idx += 32) {
+		__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + idx));
+		__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + idx));
+		acc        = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+	}
+
+	uint64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sad_c(a + idx, b + idx, size - idx);
+}
+#endif
+
+obsffmpeg::convert::scene_detect::scene_detect()
+    : _step(0), _offset(0), _packed(false), _width(0), _height(0), _cols(0), _rows(0), _row_stride(decimation),
+      _have_previous(false), _threshold(0), _average(0), _min_distance(0), _distance(0), _sad(sad_c),
+      _kernel_name("C"), _time(0), _window_time(0), _frames(0), _window_frames(0), _cuts(0)
+{}
+
+void obsffmpeg::convert::scene_detect::resize()
+{
+	_cols = static_cast<size_t>(_width) / decimation;
+	_rows = static_cast<size_t>(_height) / _row_stride;
+	_current.assign(_cols * _rows, 0);
+	_previous.assign(_cols * _rows, 0);
+	_have_previous = false;
+}
+
+void obsffmpeg::convert::scene_detect::initialize(AVPixelFormat format, int width, int height, int threshold,
+                                                  size_t min_distance)
+{
+	_cols = _rows = 0;
+	_cuts         = 0;
+	_frames = _window_frames = 0;
+	_time = _window_time = std::chrono::nanoseconds(0);
+
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+	if (!desc || (threshold <= 0) || (width < static_cast<int>(decimation))
+	    || (height < static_cast<int>(decimation)))
+		return;
+	if ((desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL)) != 0)
+		return;
+
+	// Green carries most of the brightness in RGB formats, which is close enough to luma for finding cuts.
+	const AVComponentDescriptor& comp = desc->comp[(desc->flags & AV_PIX_FMT_FLAG_RGB) ? 1 : 0];
+	if ((comp.plane != 0) || (comp.depth != 8))
+		return;
+
+	_step         = static_cast<size_t>(comp.step);
+	_offset       = static_cast<size_t>(comp.offset);
+	_width        = width;
+	_height       = height;
+	_threshold    = threshold * 255.0 / 100.0;
+	_average      = 0;
+	_min_distance = min_distance;
+	_distance     = 0;
+	_row_stride   = decimation;
+	resize();
+
+	_sad         = sad_c;
+	_kernel_name = "C";
+	_packed      = false;
+#ifdef OBSFFMPEG_SIMD_X86
+	auto level = get_simd_level();
+	_packed    = (_step == 1) && (level >= simd_level::SSE2);
+	if (level >= simd_level::AVX2) {
+		_sad         = sad_avx2;
+		_kernel_name = "AVX2";
+	} else if (level >= simd_level::SSE2) {
+		_sad         = sad_sse2;
+		_kernel_name = "SSE2";
+	}
+#endif
+}
+
+bool obsffmpeg::convert::scene_detect::is_valid()
+{
+	return (_cols > 0) && (_rows > 0);
+}
+
+bool obsffmpeg::convert::scene_detect::analyse(const uint8_t* data, size_t linesize)
+{
+	auto begin = std::chrono::high_resolution_clock::now();
+
+	// Sample the middle row of every cell, each sample being the average of a short horizontal run.
+	for (size_t y = 0; y < _rows; y++) {
+		const uint8_t* src = data + (y * _row_stride + _row_stride / 2) * linesize + _offset;
+		uint8_t*       dst = &_current[y * _cols];
+#ifdef OBSFFMPEG_SIMD_X86
+		if (_packed) {
+			decimate_sse2(dst, src, _cols);
+			continue;
+		}
+#endif
+		decimate_c(dst, src, _cols, _step);
+	}
+
+	bool cut = false;
+	if (_have_previous) {
+		double_t diff = static_cast<double_t>(_sad(_current.data(), _previous.data(), _current.size()))
+		                / static_cast<double_t>(_current.size());
+
+		cut = (_distance >= _min_distance) && (diff > _threshold) && (diff > (_average * average_ratio));
+		if (cut) {
+			_cuts++;
+			_distance = 0;
+		} else {
+			_average = _average * (1.0 - average_weight) + diff * average_weight;
+			_distance++;
+		}
+	}
+	std::swap(_current, _previous);
+	_have_previous = true;
+
+	auto elapsed = std::chrono::high_resolution_clock::now() - begin;
+	_time += elapsed;
+	_window_time += elapsed;
+	_frames++;
+	_window_frames++;
+
+	// Over budget, so look at fewer rows from now on. The next frame only serves as the new reference.
+	if (_window_frames >= budget_window) {
+		if ((_window_time > std::chrono::microseconds(budget_us * budget_window))
+		    && (_row_stride < max_row_stride) && ((_row_stride * 2) <= static_cast<size_t>(_height))) {
+			_row_stride *= 2;
+			resize();
+		}
+		_window_time   = std::chrono::nanoseconds(0);
+		_window_frames = 0;
+	}
+
+	return cut;
+}
+
+uint64_t obsffmpeg::convert::scene_detect::get_cut_count()
+{
+	return _cuts;
+}
+
+double_t obsffmpeg::convert::scene_detect::get_average_time_us()
+{
+	if (_frames == 0)
+		return 0;
+	return std::chrono::duration<double_t, std::micro>(_time).count() / static_cast<double_t>(_frames);
+}
+
+const char* obsffmpeg::convert::scene_detect::get_kernel_name()
+{
+	return _kernel_name;
+}
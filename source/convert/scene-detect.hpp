@@ -0,0 +1,98 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	namespace convert {
+		typedef uint64_t (*sad_kernel_t)(const uint8_t* a, const uint8_t* b, size_t size);
+
+		// Finds scene cuts by comparing a heavily decimated luma plane with that of the previous frame.
+		// Meant for encoders without lookahead, which otherwise can't react to a cut until the next keyframe.
+		class scene_detect {
+			// Position of the luma (or green) samples in the first plane.
+			size_t _step;
+			size_t _offset;
+			bool   _packed;
+
+			int    _width;
+			int    _height;
+			size_t _cols;
+			size_t _rows;
+			size_t _row_stride;
+
+			std::vector<uint8_t> _current;
+			std::vector<uint8_t> _previous;
+			bool                 _have_previous;
+
+			double_t _threshold;
+			double_t _average;
+			size_t   _min_distance;
+			size_t   _distance;
+
+			sad_kernel_t _sad;
+			const char*  _kernel_name;
+
+			std::chrono::nanoseconds _time;
+			std::chrono::nanoseconds _window_time;
+			uint64_t                 _frames;
+			uint64_t                 _window_frames;
+			uint64_t                 _cuts;
+
+			void resize();
+
+			public:
+			// Samples are the average of this many pixels in a row.
+			// Rows are sampled at least this far apart.
+			static const size_t decimation = 8;
+
+			scene_detect();
+
+			// Threshold is the average luma difference in percent that counts as a cut, 0 disables it.
+			// Cuts closer than min_distance frames to the previous one are ignored.
+			void initialize(AVPixelFormat format, int width, int height, int threshold,
+			                size_t min_distance);
+
+			bool is_valid();
+
+			// Returns true if the frame starts a new scene.
+			bool analyse(const uint8_t* data, size_t linesize);
+
+			uint64_t get_cut_count();
+
+			// Average time spent per frame.
+			double_t get_average_time_us();
+
+			const char* get_kernel_name();
+		};
+	} // namespace convert
+} // namespace obsffmpeg
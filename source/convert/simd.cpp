@@ -0,0 +1,113 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "simd.hpp"
+#include <vector>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/cpu.h>
+#pragma warning(pop)
+}
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#else
+#include <unistd.h>
+#endif
+
+// Used when the cache size can't be detected.
+static constexpr size_t default_llc_size = 8 * 1024 * 1024;
+
+obsffmpeg::convert::simd_level obsffmpeg::convert::get_simd_level()
+{
+#ifdef OBSFFMPEG_SIMD_X86
+	int flags = av_get_cpu_flags();
+	if (flags & AV_CPU_FLAG_AVX2)
+		return simd_level::AVX2;
+	if (flags & AV_CPU_FLAG_SSSE3)
+		return simd_level::SSSE3;
+	if (flags & AV_CPU_FLAG_SSE2)
+		return simd_level::SSE2;
+#endif
+	return simd_level::NONE;
+}
+
+const char* obsffmpeg::convert::get_simd_level_name(simd_level level)
+{
+	switch (level) {
+	case simd_level::SSE2:
+		return "SSE2";
+	case simd_level::SSSE3:
+		return "SSSE3";
+	case simd_level::AVX2:
+		return "AVX2";
+	default:
+		return "None";
+	}
+}
+
+static size_t detect_llc_size()
+{
+#if defined(_WIN32)
+	DWORD length = 0;
+	GetLogicalProcessorInformation(nullptr, &length);
+	std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+	if (infos.size() == 0 || !GetLogicalProcessorInformation(infos.data(), &length))
+		return 0;
+
+	size_t size  = 0;
+	BYTE   level = 0;
+	for (auto& info : infos) {
+		if ((info.Relationship != RelationCache) || (info.Cache.Level < level))
+			continue;
+		level = info.Cache.Level;
+		size  = info.Cache.Size;
+	}
+	return size;
+#elif defined(__APPLE__)
+	uint64_t size   = 0;
+	size_t   length = sizeof(size);
+	if (sysctlbyname("hw.l3cachesize", &size, &length, nullptr, 0) != 0)
+		return 0;
+	return static_cast<size_t>(size);
+#elif defined(_SC_LEVEL3_CACHE_SIZE)
+	long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (size <= 0)
+		size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	return (size > 0) ? static_cast<size_t>(size) : 0;
+#else
+	return 0;
+#endif
+}
+
+size_t obsffmpeg::convert::get_llc_size()
+{
+	static size_t size = []() {
+		size_t detected = detect_llc_size();
+		return detected ? detected : static_cast<size_t>(default_llc_size);
+	}();
+	return size;
+}
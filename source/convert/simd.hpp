@@ -0,0 +1,60 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OBSFFMPEG_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// MSVC allows intrinsics of any instruction set in any function, GCC and Clang have to be told per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define OBSFFMPEG_TARGET_SSE2
+#define OBSFFMPEG_TARGET_SSSE3
+#define OBSFFMPEG_TARGET_AVX2
+#else
+#define OBSFFMPEG_TARGET_SSE2 __attribute__((target("sse2")))
+#define OBSFFMPEG_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define OBSFFMPEG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace obsffmpeg {
+	namespace convert {
+		enum class simd_level {
+			NONE,
+			SSE2,
+			SSSE3,
+			AVX2,
+		};
+
+		// Best instruction set supported by the CPU, as reported by FFmpeg.
+		simd_level get_simd_level();
+
+		const char* get_simd_level_name(simd_level level);
+
+		// Size of the last level cache in bytes, or a sensible guess if it can't be detected.
+		size_t get_llc_size();
+	} // namespace convert
+} // namespace obsffmpeg
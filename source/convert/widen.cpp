@@ -0,0 +1,470 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// Widening 8-bit YUV to the 10-bit planar formats ProRes requires, upsampling chroma where needed.
+// Partial range maps exactly with a shift (16 to 64, 235 to 940). Full range replicates the top bits into the new
+// low bits, which maps 0 to 0 and 255 to 1023. Upsampled chroma uses a linear filter for center sited chroma.
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include "converter.hpp"
+
+using namespace obsffmpeg::convert;
+
+static bool prepare_widen(kernel_context& ctx, bool source_full_range, AVColorSpace source_colorspace,
+                          bool target_full_range, AVColorSpace target_colorspace)
+{
+	// Only the bit depth changes, not the color.
+	ctx.full_range = target_full_range;
+	return (source_full_range == target_full_range) && (source_colorspace == target_colorspace);
+}
+
+static inline uint16_t widen_c(uint8_t v, bool full_range)
+{
+	return static_cast<uint16_t>((v << 2) | (full_range ? (v >> 6) : 0));
+}
+
+template<typename T>
+static inline T* row_pointer(T* plane, int linesize, int row)
+{
+	typedef typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type byte_t;
+	return reinterpret_cast<T*>(reinterpret_cast<byte_t*>(plane) + static_cast<ptrdiff_t>(linesize) * row);
+}
+
+//------------------------------------------------------------------------------
+// Widen
+//------------------------------------------------------------------------------
+static inline void widen_row_c(const uint8_t* in, uint16_t* out, bool full_range, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		out[x] = widen_c(in[x], full_range);
+	}
+}
+
+static int widen_row_none(const uint8_t*, uint16_t*, bool, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSE2 static inline __m128i widen_sse2(__m128i v, __m128i full_mask)
+{
+	// v holds 16-bit values in the range 0 to 255.
+	return _mm_or_si128(_mm_slli_epi16(v, 2), _mm_and_si128(_mm_srli_epi16(v, 6), full_mask));
+}
+
+OBSFFMPEG_TARGET_SSE2 static int widen_row_sse2(const uint8_t* in, uint16_t* out, bool full_range, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(full_range ? -1 : 0);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), widen_sse2(_mm_unpacklo_epi8(v, zero), full));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 8), widen_sse2(_mm_unpackhi_epi8(v, zero), full));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static inline __m256i widen_avx2(__m256i v, __m256i full_mask)
+{
+	return _mm256_or_si256(_mm256_slli_epi16(v, 2), _mm256_and_si256(_mm256_srli_epi16(v, 6), full_mask));
+}
+
+OBSFFMPEG_TARGET_AVX2 static int widen_row_avx2(const uint8_t* in, uint16_t* out, bool full_range, int count)
+{
+	const __m256i full = _mm256_set1_epi16(full_range ? -1 : 0);
+
+	int x = 0;
+	for (; x + 32 <= count; x += 32) {
+		__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x)));
+		__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x + 16)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), widen_avx2(a, full));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x + 16), widen_avx2(b, full));
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Widen with horizontal 2:1 average (4:4:4 to 4:2:2)
+//------------------------------------------------------------------------------
+static inline void widen_half_c(const uint8_t* in, uint16_t* out, bool full_range, int width, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		int x1 = std::min(x * 2 + 1, width - 1);
+		out[x] = static_cast<uint16_t>((widen_c(in[x * 2], full_range) + widen_c(in[x1], full_range) + 1) >> 1);
+	}
+}
+
+static int widen_half_none(const uint8_t*, uint16_t*, bool, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSE2 static int widen_half_sse2(const uint8_t* in, uint16_t* out, bool full_range, int count)
+{
+	const __m128i low  = _mm_set1_epi16(0xFF);
+	const __m128i one  = _mm_set1_epi16(1);
+	const __m128i full = _mm_set1_epi16(full_range ? -1 : 0);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		__m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * 2));
+		__m128i even = widen_sse2(_mm_and_si128(v, low), full);
+		__m128i odd  = widen_sse2(_mm_srli_epi16(v, 8), full);
+		__m128i res  = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(even, odd), one), 1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), res);
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int widen_half_avx2(const uint8_t* in, uint16_t* out, bool full_range, int count)
+{
+	const __m256i low  = _mm256_set1_epi16(0xFF);
+	const __m256i one  = _mm256_set1_epi16(1);
+	const __m256i full = _mm256_set1_epi16(full_range ? -1 : 0);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m256i v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x * 2));
+		__m256i even = widen_avx2(_mm256_and_si256(v, low), full);
+		__m256i odd  = widen_avx2(_mm256_srli_epi16(v, 8), full);
+		__m256i res  = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(even, odd), one), 1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), res);
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Widen with vertical 1:2 upsampling (4:2:0 to 4:2:2)
+//------------------------------------------------------------------------------
+// Each output row sits a quarter of a chroma row away from the nearest input row: 3/4 near + 1/4 far.
+// The result has two extra bits of precision, a shift of 2 removes them again.
+template<bool Interleaved>
+static inline void vertical_c(const uint8_t* near_row, const uint8_t* far_row, uint16_t* out0, uint16_t* out1,
+                              bool full_range, int shift, int begin, int end)
+{
+	int round = (1 << shift) >> 1;
+	for (int x = begin; x < end; x++) {
+		if (Interleaved) {
+			int u = widen_c(near_row[x * 2], full_range) * 3 + widen_c(far_row[x * 2], full_range);
+			int v = widen_c(near_row[x * 2 + 1], full_range) * 3;
+			v += widen_c(far_row[x * 2 + 1], full_range);
+			out0[x] = static_cast<uint16_t>((u + round) >> shift);
+			out1[x] = static_cast<uint16_t>((v + round) >> shift);
+		} else {
+			int u   = widen_c(near_row[x], full_range) * 3 + widen_c(far_row[x], full_range);
+			out0[x] = static_cast<uint16_t>((u + round) >> shift);
+		}
+	}
+}
+
+template<bool Interleaved>
+static int vertical_none(const uint8_t*, const uint8_t*, uint16_t*, uint16_t*, bool, int, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+OBSFFMPEG_TARGET_SSE2 static inline __m128i blend_sse2(__m128i near_v, __m128i far_v, __m128i round, __m128i shift)
+{
+	__m128i sum = _mm_add_epi16(_mm_add_epi16(near_v, _mm_slli_epi16(near_v, 1)), far_v);
+	return _mm_srl_epi16(_mm_add_epi16(sum, round), shift);
+}
+
+template<bool Interleaved>
+OBSFFMPEG_TARGET_SSE2 static int vertical_sse2(const uint8_t* near_row, const uint8_t* far_row, uint16_t* out0,
+                                               uint16_t* out1, bool full_range, int shift, int count)
+{
+	const __m128i zero   = _mm_setzero_si128();
+	const __m128i low    = _mm_set1_epi16(0xFF);
+	const __m128i full   = _mm_set1_epi16(full_range ? -1 : 0);
+	const __m128i round  = _mm_set1_epi16(static_cast<int16_t>((1 << shift) >> 1));
+	const __m128i shiftv = _mm_cvtsi32_si128(shift);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		if (Interleaved) {
+			__m128i n  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(near_row + x * 2));
+			__m128i f  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(far_row + x * 2));
+			__m128i nu = widen_sse2(_mm_and_si128(n, low), full);
+			__m128i fu = widen_sse2(_mm_and_si128(f, low), full);
+			__m128i nv = widen_sse2(_mm_srli_epi16(n, 8), full);
+			__m128i fv = widen_sse2(_mm_srli_epi16(f, 8), full);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + x), blend_sse2(nu, fu, round, shiftv));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out1 + x), blend_sse2(nv, fv, round, shiftv));
+		} else {
+			__m128i n = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(near_row + x));
+			__m128i f = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(far_row + x));
+			n         = widen_sse2(_mm_unpacklo_epi8(n, zero), full);
+			f         = widen_sse2(_mm_unpacklo_epi8(f, zero), full);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + x), blend_sse2(n, f, round, shiftv));
+		}
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static inline __m256i blend_avx2(__m256i near_v, __m256i far_v, __m256i round, __m128i shift)
+{
+	__m256i sum = _mm256_add_epi16(_mm256_add_epi16(near_v, _mm256_slli_epi16(near_v, 1)), far_v);
+	return _mm256_srl_epi16(_mm256_add_epi16(sum, round), shift);
+}
+
+template<bool Interleaved>
+OBSFFMPEG_TARGET_AVX2 static int vertical_avx2(const uint8_t* near_row, const uint8_t* far_row, uint16_t* out0,
+                                               uint16_t* out1, bool full_range, int shift, int count)
+{
+	const __m256i low    = _mm256_set1_epi16(0xFF);
+	const __m256i full   = _mm256_set1_epi16(full_range ? -1 : 0);
+	const __m256i round  = _mm256_set1_epi16(static_cast<int16_t>((1 << shift) >> 1));
+	const __m128i shiftv = _mm_cvtsi32_si128(shift);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16) {
+		if (Interleaved) {
+			// Each lane holds 8 pairs, so splitting them keeps the samples in order.
+			__m256i n  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(near_row + x * 2));
+			__m256i f  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(far_row + x * 2));
+			__m256i nu = widen_avx2(_mm256_and_si256(n, low), full);
+			__m256i fu = widen_avx2(_mm256_and_si256(f, low), full);
+			__m256i nv = widen_avx2(_mm256_srli_epi16(n, 8), full);
+			__m256i fv = widen_avx2(_mm256_srli_epi16(f, 8), full);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out0 + x), blend_avx2(nu, fu, round, shiftv));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out1 + x), blend_avx2(nv, fv, round, shiftv));
+		} else {
+			__m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(near_row + x));
+			__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(far_row + x));
+			__m256i r = blend_avx2(widen_avx2(_mm256_cvtepu8_epi16(n), full),
+			                       widen_avx2(_mm256_cvtepu8_epi16(f), full), round, shiftv);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out0 + x), r);
+		}
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Horizontal 1:2 upsampling (4:2:2 to 4:4:4)
+//------------------------------------------------------------------------------
+// Works on the unrounded output of the vertical pass, so the result has four extra bits to remove.
+static inline void upsample_c(const uint16_t* in, uint16_t* out, int count, int width, int begin, int end)
+{
+	for (int x = begin; x < end; x++) {
+		int prev       = in[std::max(x - 1, 0)];
+		int next       = in[std::min(x + 1, count - 1)];
+		int center     = in[x] * 3;
+		out[x * 2]     = static_cast<uint16_t>((center + prev + 8) >> 4);
+		if (x * 2 + 1 < width)
+			out[x * 2 + 1] = static_cast<uint16_t>((center + next + 8) >> 4);
+	}
+}
+
+static int upsample_none(const uint16_t*, uint16_t*, int)
+{
+	return 0;
+}
+
+#ifdef OBSFFMPEG_SIMD_X86
+// Both skip the first sample, which has no left neighbour, and return the end of the range they did.
+OBSFFMPEG_TARGET_SSE2 static int upsample_sse2(const uint16_t* in, uint16_t* out, int count)
+{
+	const __m128i round = _mm_set1_epi16(8);
+
+	int x = 1;
+	for (; x + 8 < count; x += 8) {
+		__m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+		__m128i prev   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x - 1));
+		__m128i next   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x + 1));
+		center         = _mm_add_epi16(_mm_add_epi16(center, _mm_slli_epi16(center, 1)), round);
+		__m128i even   = _mm_srli_epi16(_mm_add_epi16(center, prev), 4);
+		__m128i odd    = _mm_srli_epi16(_mm_add_epi16(center, next), 4);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2), _mm_unpacklo_epi16(even, odd));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 2 + 8), _mm_unpackhi_epi16(even, odd));
+	}
+	return x;
+}
+
+OBSFFMPEG_TARGET_AVX2 static int upsample_avx2(const uint16_t* in, uint16_t* out, int count)
+{
+	const __m256i round = _mm256_set1_epi16(8);
+
+	int x = 1;
+	for (; x + 16 < count; x += 16) {
+		__m256i center = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+		__m256i prev   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x - 1));
+		__m256i next   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + 1));
+		center         = _mm256_add_epi16(_mm256_add_epi16(center, _mm256_slli_epi16(center, 1)), round);
+		__m256i even   = _mm256_srli_epi16(_mm256_add_epi16(center, prev), 4);
+		__m256i odd    = _mm256_srli_epi16(_mm256_add_epi16(center, next), 4);
+		// Interleaving works per lane, which leaves the halves of the two results swapped.
+		__m256i lo = _mm256_unpacklo_epi16(even, odd);
+		__m256i hi = _mm256_unpackhi_epi16(even, odd);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 2 + 16),
+		                    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return x;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Kernels
+//------------------------------------------------------------------------------
+typedef int (*widen_t)(const uint8_t*, uint16_t*, bool, int);
+typedef int (*vertical_t)(const uint8_t*, const uint8_t*, uint16_t*, uint16_t*, bool, int, int);
+typedef int (*upsample_t)(const uint16_t*, uint16_t*, int);
+
+template<widen_t Widen>
+static inline void widen_plane(kernel_context const& ctx, const uint8_t* src, int src_linesize, uint16_t* dst,
+                               int dst_linesize, int row_begin, int row_end)
+{
+	for (int row = row_begin; row < row_end; row++) {
+		const uint8_t* in  = row_pointer(src, src_linesize, row);
+		uint16_t*      out = row_pointer(dst, dst_linesize, row);
+		widen_row_c(in, out, ctx.full_range, Widen(in, out, ctx.full_range, ctx.width), ctx.width);
+	}
+}
+
+template<widen_t Widen>
+static void i444_to_p444(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	for (size_t plane = 0; plane < 3; plane++) {
+		widen_plane<Widen>(ctx, src[plane], src_linesize[plane], reinterpret_cast<uint16_t*>(dst[plane]),
+		                   dst_linesize[plane], row_begin, row_end);
+	}
+}
+
+template<widen_t Widen, widen_t Half>
+static void i444_to_p422(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                         uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	widen_plane<Widen>(ctx, src[0], src_linesize[0], reinterpret_cast<uint16_t*>(dst[0]), dst_linesize[0],
+	                   row_begin, row_end);
+
+	int count = (ctx.width + 1) / 2;
+	for (int row = row_begin; row < row_end; row++) {
+		for (size_t plane = 1; plane < 3; plane++) {
+			const uint8_t* in  = row_pointer(src[plane], src_linesize[plane], row);
+			uint16_t* out = row_pointer(reinterpret_cast<uint16_t*>(dst[plane]), dst_linesize[plane], row);
+			int       x   = Half(in, out, ctx.full_range, ctx.width / 2);
+			widen_half_c(in, out, ctx.full_range, ctx.width, x, count);
+		}
+	}
+}
+
+// Finds the two chroma rows of a 4:2:0 frame that contribute to a luma row.
+static inline void chroma_rows(kernel_context const& ctx, int row, int& near_row, int& far_row)
+{
+	int last = (ctx.height + 1) / 2 - 1;
+	near_row = row / 2;
+	far_row  = (row & 1) ? std::min(near_row + 1, last) : std::max(near_row - 1, 0);
+}
+
+template<bool Interleaved, widen_t Widen, vertical_t Vertical>
+static void yuv420_to_p422(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                           uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	widen_plane<Widen>(ctx, src[0], src_linesize[0], reinterpret_cast<uint16_t*>(dst[0]), dst_linesize[0],
+	                   row_begin, row_end);
+
+	int count = (ctx.width + 1) / 2;
+	for (int row = row_begin; row < row_end; row++) {
+		int near_row, far_row;
+		chroma_rows(ctx, row, near_row, far_row);
+
+		uint16_t* u = row_pointer(reinterpret_cast<uint16_t*>(dst[1]), dst_linesize[1], row);
+		uint16_t* v = row_pointer(reinterpret_cast<uint16_t*>(dst[2]), dst_linesize[2], row);
+		for (size_t plane = 1; plane < (Interleaved ? 2u : 3u); plane++) {
+			const uint8_t* n   = row_pointer(src[plane], src_linesize[plane], near_row);
+			const uint8_t* f   = row_pointer(src[plane], src_linesize[plane], far_row);
+			uint16_t*      out = (plane == 1) ? u : v;
+			int            x   = Vertical(n, f, out, v, ctx.full_range, 2, count);
+			vertical_c<Interleaved>(n, f, out, v, ctx.full_range, 2, x, count);
+		}
+	}
+}
+
+template<bool Interleaved, widen_t Widen, vertical_t Vertical, upsample_t Upsample>
+static void yuv420_to_p444(kernel_context const& ctx, const uint8_t* const src[], const int src_linesize[],
+                           uint8_t* const dst[], const int dst_linesize[], int row_begin, int row_end)
+{
+	widen_plane<Widen>(ctx, src[0], src_linesize[0], reinterpret_cast<uint16_t*>(dst[0]), dst_linesize[0],
+	                   row_begin, row_end);
+
+	// The vertical pass leaves its unrounded result here for the horizontal pass.
+	int                   count = (ctx.width + 1) / 2;
+	std::vector<uint16_t> buffer(static_cast<size_t>(count) * 2);
+	uint16_t*             temp[2] = {buffer.data(), buffer.data() + count};
+
+	for (int row = row_begin; row < row_end; row++) {
+		int near_row, far_row;
+		chroma_rows(ctx, row, near_row, far_row);
+
+		for (size_t plane = 1; plane < (Interleaved ? 2u : 3u); plane++) {
+			const uint8_t* n = row_pointer(src[plane], src_linesize[plane], near_row);
+			const uint8_t* f = row_pointer(src[plane], src_linesize[plane], far_row);
+			uint16_t*      t = temp[plane - 1];
+			int            x = Vertical(n, f, t, temp[1], ctx.full_range, 0, count);
+			vertical_c<Interleaved>(n, f, t, temp[1], ctx.full_range, 0, x, count);
+		}
+
+		for (size_t plane = 1; plane < 3; plane++) {
+			uint16_t* out = row_pointer(reinterpret_cast<uint16_t*>(dst[plane]), dst_linesize[plane], row);
+			upsample_c(temp[plane - 1], out, count, ctx.width, 0, 1);
+			int x = std::max(Upsample(temp[plane - 1], out, count), 1);
+			upsample_c(temp[plane - 1], out, count, ctx.width, x, count);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Registration
+//------------------------------------------------------------------------------
+#define ADD_KERNELS(LEVEL, SUFFIX, WIDEN, HALF, VERTICAL, UPSAMPLE) \
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV444P10, LEVEL, "I444 to I444P10 " SUFFIX, \
+	                   i444_to_p444<WIDEN>, prepare_widen, 1}); \
+	kernels.push_back({AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P10, LEVEL, "I444 to I422P10 " SUFFIX, \
+	                   i444_to_p422<WIDEN, HALF>, prepare_widen, 1}); \
+	kernels.push_back({AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P10, LEVEL, "I420 to I422P10 " SUFFIX, \
+	                   yuv420_to_p422<false, WIDEN, VERTICAL<false>>, prepare_widen, 1}); \
+	kernels.push_back({AV_PIX_FMT_NV12, AV_PIX_FMT_YUV422P10, LEVEL, "NV12 to I422P10 " SUFFIX, \
+	                   yuv420_to_p422<true, WIDEN, VERTICAL<true>>, prepare_widen, 1}); \
+	kernels.push_back({AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P10, LEVEL, "I420 to I444P10 " SUFFIX, \
+	                   yuv420_to_p444<false, WIDEN, VERTICAL<false>, UPSAMPLE>, prepare_widen, 1}); \
+	kernels.push_back({AV_PIX_FMT_NV12, AV_PIX_FMT_YUV444P10, LEVEL, "NV12 to I444P10 " SUFFIX, \
+	                   yuv420_to_p444<true, WIDEN, VERTICAL<true>, UPSAMPLE>, prepare_widen, 1});
+
+void obsffmpeg::convert::register_widen_kernels(std::vector<kernel_info>& kernels)
+{
+	ADD_KERNELS(simd_level::NONE, "(C)", widen_row_none, widen_half_none, vertical_none, upsample_none);
+#ifdef OBSFFMPEG_SIMD_X86
+	ADD_KERNELS(simd_level::SSE2, "(SSE2)", widen_row_sse2, widen_half_sse2, vertical_sse2, upsample_sse2);
+	ADD_KERNELS(simd_level::AVX2, "(AVX2)", widen_row_avx2, widen_half_avx2, vertical_avx2, upsample_avx2);
+#endif
+}
@@ -20,6 +20,8 @@
 // SOFTWARE.
 
 #include "encoder.hpp"
+#include <climits>
+#include <cstring>
 #include <iomanip>
 #include <set>
 #include <sstream>
@@ -40,6 +42,7 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/dict.h>
 #include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libavutil/pixdesc.h>
 #pragma warning(pop)
@@ -63,9 +66,62 @@ extern "C" {
 #define ST_FFMPEG_THREADS "FFmpeg.Threads"
 #define ST_FFMPEG_COLORFORMAT "FFmpeg.ColorFormat"
 #define ST_FFMPEG_STANDARDCOMPLIANCE "FFmpeg.StandardCompliance"
+#define ST_FFMPEG_WORKERTHREAD "FFmpeg.WorkerThread"
+#define ST_FFMPEG_PARALLELFRAMES "FFmpeg.ParallelFrames"
+#define ST_FFMPEG_PARALLELGOPS "FFmpeg.ParallelGOPs"
+#define ST_FFMPEG_CONVERSIONTHREADS "FFmpeg.ConversionThreads"
+#define ST_FFMPEG_CONVERSIONBANDS "FFmpeg.ConversionBands"
+#define ST_FFMPEG_SHAREDCONVERSION "FFmpeg.SharedConversion"
+#define ST_FFMPEG_FRAMEANALYSIS "FFmpeg.FrameAnalysis"
+#define ST_FFMPEG_DUPLICATEFRAMES "FFmpeg.DuplicateFrames"
+#define ST_FFMPEG_REGIONOFINTEREST "FFmpeg.RegionOfInterest"
+#define ST_FFMPEG_SCENECUTTHRESHOLD "FFmpeg.SceneCutThreshold"
+#define ST_FFMPEG_SCENECUTDISTANCE "FFmpeg.SceneCutDistance"
+#define ST_FFMPEG_RESOLUTIONGOVERNOR "FFmpeg.ResolutionGovernor"
+#define ST_FFMPEG_PRESETLEVELS "FFmpeg.PresetLevels"
+#define ST_FFMPEG_BACKPRESSURE "FFmpeg.Backpressure"
+#define ST_FFMPEG_BACKPRESSUREFRAMES "FFmpeg.BackpressureFrames"
+#define ST_FFMPEG_BACKPRESSUREMEMORY "FFmpeg.BackpressureMemory"
+#define ST_FFMPEG_LADDER "FFmpeg.Ladder"
+
+// Worker Thread
+static constexpr size_t worker_frame_queue_size  = 4;
+static constexpr size_t worker_packet_queue_size = 16;
+
+// Zero-Copy
+static constexpr int    zerocopy_alignment    = 32;
+static constexpr size_t zerocopy_probe_frames = 8;
+
+// Longest the backpressure policy blocks the encode call before it drops the frame after all.
+static constexpr int backpressure_block_timeout = 100;
+
+// Most seconds of video the parallel GOP lanes may hold at once.
+static constexpr int parallel_latency_limit = 10;
 
 enum class keyframe_type { SECONDS, FRAMES };
 
+// Not every intra-only encoder has the capability flag, so the codec descriptor is asked as well.
+static bool is_intra_only(const AVCodec* codec)
+{
+	if (codec->capabilities & AV_CODEC_CAP_INTRA_ONLY)
+		return true;
+	const AVCodecDescriptor* desc = avcodec_descriptor_get(codec->id);
+	return desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY);
+}
+
+// Stops the encoder from placing keyframes of its own on scene cuts, returns false if it has no option for it.
+static bool disable_scene_cut(const AVCodec* codec, AVCodecContext* context)
+{
+	if (av_opt_find(context->priv_data, "no-scenecut", nullptr, 0, 0))
+		return av_opt_set_int(context->priv_data, "no-scenecut", 1, 0) >= 0;
+	if (av_opt_find(context->priv_data, "sc_threshold", nullptr, 0, 0)) {
+		// libx264 turns it off at 0, the mpegvideo encoders only never reach the largest threshold.
+		bool x264 = strncmp(codec->name, "libx264", 7) == 0;
+		return av_opt_set_int(context->priv_data, "sc_threshold", x264 ? 0 : INT_MAX, 0) >= 0;
+	}
+	return false;
+}
+
 static void* _create(obs_data_t* settings, obs_encoder_t* encoder) noexcept try {
 #ifdef DEBUG_CALL_ORDER
 	PLOG_INFO("%s %llX %llX", __FUNCTION_NAME__, settings, encoder);
@@ -464,6 +520,25 @@ void obsffmpeg::encoder_factory::get_defaults(obs_data_t* settings, bool hw_enco
 			obs_data_set_default_int(settings, ST_FFMPEG_COLORFORMAT,
 			                         static_cast<int64_t>(AV_PIX_FMT_NONE));
 			obs_data_set_default_int(settings, ST_FFMPEG_THREADS, 0);
+			obs_data_set_default_bool(settings, ST_FFMPEG_WORKERTHREAD, false);
+			obs_data_set_default_int(settings, ST_FFMPEG_PARALLELFRAMES, 0);
+			obs_data_set_default_int(settings, ST_FFMPEG_PARALLELGOPS, 0);
+			obs_data_set_default_int(settings, ST_FFMPEG_CONVERSIONTHREADS, 1);
+			obs_data_set_default_int(settings, ST_FFMPEG_CONVERSIONBANDS, 0);
+			obs_data_set_default_bool(settings, ST_FFMPEG_SHAREDCONVERSION, false);
+			obs_data_set_default_bool(settings, ST_FFMPEG_FRAMEANALYSIS, false);
+			obs_data_set_default_int(settings, ST_FFMPEG_DUPLICATEFRAMES,
+			                         static_cast<int64_t>(obsffmpeg::duplicate_mode::DISABLED));
+			obs_data_set_default_int(settings, ST_FFMPEG_REGIONOFINTEREST, 0);
+			obs_data_set_default_int(settings, ST_FFMPEG_SCENECUTTHRESHOLD, 0);
+			obs_data_set_default_int(settings, ST_FFMPEG_SCENECUTDISTANCE, 30);
+			obs_data_set_default_bool(settings, ST_FFMPEG_RESOLUTIONGOVERNOR, false);
+			obs_data_set_default_string(settings, ST_FFMPEG_PRESETLEVELS, "");
+			obs_data_set_default_int(settings, ST_FFMPEG_BACKPRESSURE,
+			                         static_cast<int64_t>(obsffmpeg::backpressure_mode::DISABLED));
+			obs_data_set_default_int(settings, ST_FFMPEG_BACKPRESSUREFRAMES, 0);
+			obs_data_set_default_int(settings, ST_FFMPEG_BACKPRESSUREMEMORY, 0);
+			obs_data_set_default_string(settings, ST_FFMPEG_LADDER, "");
 		}
 		obs_data_set_default_int(settings, ST_FFMPEG_STANDARDCOMPLIANCE, FF_COMPLIANCE_STRICT);
 	}
@@ -553,6 +628,114 @@ void obsffmpeg::encoder_factory::get_properties(obs_properties_t* props, bool hw
 				                                  0, std::thread::hardware_concurrency() * 2, 1);
 				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_THREADS)));
 			}
+			{
+				auto p = obs_properties_add_bool(grp, ST_FFMPEG_WORKERTHREAD,
+				                                 TRANSLATE(ST_FFMPEG_WORKERTHREAD));
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_WORKERTHREAD)));
+			}
+			if (is_intra_only(avcodec_ptr) && ((avcodec_ptr->capabilities & AV_CODEC_CAP_DELAY) == 0)) {
+				auto p = obs_properties_add_int_slider(grp, ST_FFMPEG_PARALLELFRAMES,
+				                                       TRANSLATE(ST_FFMPEG_PARALLELFRAMES), 0, 16, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_PARALLELFRAMES)));
+			}
+			if (!is_intra_only(avcodec_ptr)) {
+				auto p = obs_properties_add_int_slider(grp, ST_FFMPEG_PARALLELGOPS,
+				                                       TRANSLATE(ST_FFMPEG_PARALLELGOPS), 0, 8, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_PARALLELGOPS)));
+			}
+			{
+				auto p = obs_properties_add_int_slider(grp, ST_FFMPEG_CONVERSIONTHREADS,
+				                                       TRANSLATE(ST_FFMPEG_CONVERSIONTHREADS), 1,
+				                                       std::thread::hardware_concurrency(), 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_CONVERSIONTHREADS)));
+			}
+			{
+				auto p = obs_properties_add_int_slider(grp, ST_FFMPEG_CONVERSIONBANDS,
+				                                       TRANSLATE(ST_FFMPEG_CONVERSIONBANDS), 0, 64, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_CONVERSIONBANDS)));
+			}
+			{
+				auto p = obs_properties_add_bool(grp, ST_FFMPEG_SHAREDCONVERSION,
+				                                 TRANSLATE(ST_FFMPEG_SHAREDCONVERSION));
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_SHAREDCONVERSION)));
+			}
+			{
+				auto p = obs_properties_add_bool(grp, ST_FFMPEG_FRAMEANALYSIS,
+				                                 TRANSLATE(ST_FFMPEG_FRAMEANALYSIS));
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_FRAMEANALYSIS)));
+			}
+			{
+				auto p = obs_properties_add_list(grp, ST_FFMPEG_DUPLICATEFRAMES,
+				                                 TRANSLATE(ST_FFMPEG_DUPLICATEFRAMES),
+				                                 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_DUPLICATEFRAMES)));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_DUPLICATEFRAMES ".Disabled"),
+				                          static_cast<int64_t>(obsffmpeg::duplicate_mode::DISABLED));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_DUPLICATEFRAMES ".Skip"),
+				                          static_cast<int64_t>(obsffmpeg::duplicate_mode::SKIP));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_DUPLICATEFRAMES ".Repeat"),
+				                          static_cast<int64_t>(obsffmpeg::duplicate_mode::REPEAT));
+			}
+			{
+				auto p = obs_properties_add_int_slider(
+				    grp, ST_FFMPEG_REGIONOFINTEREST, TRANSLATE(ST_FFMPEG_REGIONOFINTEREST), 0, 100, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_REGIONOFINTEREST)));
+				obs_property_int_set_suffix(p, " %");
+			}
+			{
+				auto p = obs_properties_add_int_slider(grp, ST_FFMPEG_SCENECUTTHRESHOLD,
+				                                       TRANSLATE(ST_FFMPEG_SCENECUTTHRESHOLD), 0, 100,
+				                                       1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_SCENECUTTHRESHOLD)));
+				obs_property_int_set_suffix(p, " %");
+			}
+			{
+				auto p = obs_properties_add_int(grp, ST_FFMPEG_SCENECUTDISTANCE,
+				                                TRANSLATE(ST_FFMPEG_SCENECUTDISTANCE), 1, 600, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_SCENECUTDISTANCE)));
+				obs_property_int_set_suffix(p, " frames");
+			}
+			{
+				auto p = obs_properties_add_bool(grp, ST_FFMPEG_RESOLUTIONGOVERNOR,
+				                                 TRANSLATE(ST_FFMPEG_RESOLUTIONGOVERNOR));
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_RESOLUTIONGOVERNOR)));
+			}
+			{
+				auto p = obs_properties_add_text(grp, ST_FFMPEG_PRESETLEVELS,
+				                                 TRANSLATE(ST_FFMPEG_PRESETLEVELS), OBS_TEXT_DEFAULT);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_PRESETLEVELS)));
+			}
+			{
+				auto p = obs_properties_add_list(grp, ST_FFMPEG_BACKPRESSURE,
+				                                 TRANSLATE(ST_FFMPEG_BACKPRESSURE), OBS_COMBO_TYPE_LIST,
+				                                 OBS_COMBO_FORMAT_INT);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_BACKPRESSURE)));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_BACKPRESSURE ".Disabled"),
+				                          static_cast<int64_t>(obsffmpeg::backpressure_mode::DISABLED));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_BACKPRESSURE ".Drop"),
+				                          static_cast<int64_t>(obsffmpeg::backpressure_mode::DROP));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_BACKPRESSURE ".Decimate"),
+				                          static_cast<int64_t>(obsffmpeg::backpressure_mode::DECIMATE));
+				obs_property_list_add_int(p, TRANSLATE(ST_FFMPEG_BACKPRESSURE ".Block"),
+				                          static_cast<int64_t>(obsffmpeg::backpressure_mode::BLOCK));
+			}
+			{
+				auto p = obs_properties_add_int(grp, ST_FFMPEG_BACKPRESSUREFRAMES,
+				                                TRANSLATE(ST_FFMPEG_BACKPRESSUREFRAMES), 0, 256, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_BACKPRESSUREFRAMES)));
+				obs_property_int_set_suffix(p, " frames");
+			}
+			{
+				auto p = obs_properties_add_int(grp, ST_FFMPEG_BACKPRESSUREMEMORY,
+				                                TRANSLATE(ST_FFMPEG_BACKPRESSUREMEMORY), 0, 16384, 1);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_BACKPRESSUREMEMORY)));
+				obs_property_int_set_suffix(p, " MiB");
+			}
+			{
+				auto p = obs_properties_add_text(grp, ST_FFMPEG_LADDER, TRANSLATE(ST_FFMPEG_LADDER),
+				                                 OBS_TEXT_DEFAULT);
+				obs_property_set_long_description(p, TRANSLATE(DESC(ST_FFMPEG_LADDER)));
+			}
 		}
 		{
 			auto p = obs_properties_add_list(grp, ST_FFMPEG_STANDARDCOMPLIANCE,
@@ -640,6 +823,17 @@ void obsffmpeg::encoder::initialize_sw(obs_data_t* settings)
 		_swscale.set_target_color(_context->color_range == AVCOL_RANGE_JPEG, _context->colorspace);
 		_swscale.set_target_format(_pixfmt_target);
 
+		// Spread conversion work over additional threads if requested.
+		size_t threads = static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_CONVERSIONTHREADS));
+		size_t bands   = static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_CONVERSIONBANDS));
+		if (threads > 1)
+			_threadpool = std::make_shared<obsffmpeg::threadpool>(threads);
+		_swscale.set_threads(_threadpool);
+		_swscale.set_band_count(static_cast<uint32_t>(bands ? bands : threads));
+
+		_frame_pool.set_resolution(_context->width, _context->height);
+		_frame_pool.set_pixel_format(_pixfmt_target);
+
 		// Create Scaler
 		if (!_swscale.initialize(SWS_POINT)) {
 			std::stringstream sstr;
@@ -651,6 +845,51 @@ void obsffmpeg::encoder::initialize_sw(obs_data_t* settings)
 			     << (_swscale.is_source_full_range() ? "full" : "partial") << " range.";
 			throw std::runtime_error(sstr.str());
 		}
+
+		_plane_copy.initialize(_pixfmt_target, _context->width, _context->height, _threadpool);
+
+		// Skip swscale for conversions that have a dedicated kernel.
+		_converter.initialize(_pixfmt_source, _swscale.is_source_full_range(), _swscale.get_source_colorspace(),
+		                      _pixfmt_target, _swscale.is_target_full_range(), _swscale.get_target_colorspace(),
+		                      _context->width, _context->height, _threadpool);
+
+		// Other encoders converting the same canvas the same way can share the result.
+		if (obs_data_get_bool(settings, ST_FFMPEG_SHAREDCONVERSION)) {
+			frame_cache_key key;
+			key.source_format = _pixfmt_source;
+			key.format        = _pixfmt_target;
+			key.width         = static_cast<uint32_t>(_context->width);
+			key.height        = static_cast<uint32_t>(_context->height);
+			key.full_range    = _context->color_range == AVCOL_RANGE_JPEG;
+			key.colorspace    = _context->colorspace;
+			key.fps_num       = voi->fps_num;
+			key.fps_den       = voi->fps_den;
+			_frame_cache      = frame_cache::subscribe(key);
+		}
+
+		// Duplicates are found through the frame analysis, and skipped ones are still encoded once per second
+		// so that players and muxers never see a long gap.
+		_duplicate_mode = static_cast<duplicate_mode>(obs_data_get_int(settings, ST_FFMPEG_DUPLICATEFRAMES));
+		_duplicate_keepalive = std::max<size_t>(1, voi->fps_num / std::max<uint32_t>(1, voi->fps_den));
+
+		// Needs to be known before the encoder is first opened, its first level applies from the start.
+		_presets.initialize(obs_data_get_string(settings, ST_FFMPEG_PRESETLEVELS), voi->fps_num, voi->fps_den);
+
+		// Changed regions of the frame can be given more bits, which needs the change map of the analysis.
+		int roi_strength = static_cast<int>(obs_data_get_int(settings, ST_FFMPEG_REGIONOFINTEREST));
+		if ((roi_strength > 0) && !convert::roi_map::is_supported())
+			PLOG_WARNING("[%s] FFmpeg is too old for regions of interest, ignoring them.", _codec->name);
+		_roi.initialize(_context->width, _context->height, roi_strength);
+
+		// Encoders without lookahead don't notice scene cuts, so force keyframes on them ourselves.
+		_scene.initialize(_pixfmt_source, _context->width, _context->height,
+		                  static_cast<int>(obs_data_get_int(settings, ST_FFMPEG_SCENECUTTHRESHOLD)),
+		                  static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_SCENECUTDISTANCE)));
+
+		// Hash the input while it is being converted anyway.
+		if (obs_data_get_bool(settings, ST_FFMPEG_FRAMEANALYSIS)
+		    || (_duplicate_mode != duplicate_mode::DISABLED) || _roi.is_valid())
+			_analysis.initialize(_pixfmt_source, _context->width, _context->height);
 	}
 }
 
@@ -689,63 +928,155 @@ void obsffmpeg::encoder::initialize_hw(obs_data_t*)
 		throw std::runtime_error("Failed to initialize AVHWFramesContext.");
 }
 
-void obsffmpeg::encoder::push_free_frame(std::shared_ptr<AVFrame> frame)
+void obsffmpeg::encoder::start_worker()
 {
-	auto now = std::chrono::high_resolution_clock::now();
-	if (_free_frames.size() > 0) {
-		if ((now - _free_frames_last_used) < std::chrono::seconds(1)) {
-			_free_frames.push(frame);
-		}
-	} else {
-		_free_frames.push(frame);
-		_free_frames_last_used = std::chrono::high_resolution_clock::now();
+	_worker_frames  = std::make_unique<spsc_ring<std::shared_ptr<AVFrame>>>(worker_frame_queue_size);
+	_worker_packets = std::make_unique<spsc_ring<AVPacket*>>(worker_packet_queue_size);
+
+	_worker_stop   = false;
+	_worker_failed = false;
+	_worker        = std::thread([this]() { worker_main(); });
+}
+
+void obsffmpeg::encoder::stop_worker()
+{
+	if (!_worker.joinable())
+		return;
+
+	{
+		std::unique_lock<std::mutex> ulock(_worker_lock);
+		_worker_stop = true;
+	}
+	_worker_cv.notify_all();
+	_worker.join();
+
+	// Release everything that is still in flight.
+	AVPacket* pkt = nullptr;
+	while (_worker_packets->pop(pkt)) {
+		_packet_pool.release_packet(pkt);
+	}
+	for (auto ptr : _worker_overflow) {
+		_packet_pool.release_packet(ptr);
+	}
+	_worker_overflow.clear();
+
+	std::shared_ptr<AVFrame> frame;
+	while (_worker_frames->pop(frame)) {
 	}
 }
 
-std::shared_ptr<AVFrame> obsffmpeg::encoder::pop_free_frame()
+void obsffmpeg::encoder::worker_main()
 {
 	std::shared_ptr<AVFrame> frame;
-	if (_free_frames.size() > 0) {
-		// Re-use existing frames first.
-		frame = _free_frames.top();
-		_free_frames.pop();
-	} else {
-		if (_hwinst) {
-			frame = _hwinst->allocate_frame(_context->hw_frames_ctx);
-		} else {
-			frame = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* frame) {
-				av_frame_unref(frame);
-				av_frame_free(&frame);
-			});
-
-			frame->width  = _context->width;
-			frame->height = _context->height;
-			frame->format = _context->pix_fmt;
-
-			int res = av_frame_get_buffer(frame.get(), 32);
-			if (res < 0) {
-				throw std::runtime_error(ffmpeg::tools::get_error_description(res));
+	bool                     failed = false;
+	while (!_worker_stop && !failed) {
+		if (!_worker_frames->pop(frame)) {
+			// Nothing to do, sleep until the encode thread hands us a new frame.
+			std::unique_lock<std::mutex> ulock(_worker_lock);
+			_worker_cv.wait(ulock, [this]() { return _worker_stop || !_worker_frames->empty(); });
+			continue;
+		}
+
+		// Let the encode thread know that there is room for another frame.
+		{
+			std::unique_lock<std::mutex> ulock(_worker_lock);
+		}
+		_encode_cv.notify_all();
+
+		bool   sent_frame = false;
+		size_t packets    = 0;
+		while (!sent_frame && !failed) {
+			int res = avcodec_send_frame(_context, frame.get());
+			switch (res) {
+			case 0:
+				sent_frame = true;
+				break;
+			case AVERROR(EAGAIN):
+				// The encoder is full, drain it and then try again.
+				if (!worker_drain(packets)) {
+					failed = true;
+				} else if (packets == 0) {
+					PLOG_ERROR("Both send and recieve returned EAGAIN, encoder is broken.");
+					failed = true;
+				}
+				break;
+			case AVERROR_EOF:
+				PLOG_ERROR("Skipped frame due to end of stream.");
+				release_frames(1);
+				sent_frame = true;
+				break;
+			default:
+				PLOG_ERROR("Failed to encode frame: %s (%ld).",
+				           ffmpeg::tools::get_error_description(res), res);
+				failed = true;
+				break;
 			}
 		}
+		frame = nullptr;
+
+		if (!failed && !worker_drain(packets)) {
+			failed = true;
+		}
 	}
 
-	return frame;
+	if (failed) {
+		{
+			std::unique_lock<std::mutex> ulock(_worker_lock);
+			_worker_failed = true;
+		}
+		_encode_cv.notify_all();
+	}
 }
 
-void obsffmpeg::encoder::push_used_frame(std::shared_ptr<AVFrame> frame)
+bool obsffmpeg::encoder::worker_drain(size_t& packets)
 {
-	_used_frames.push(frame);
+	packets = 0;
+	while (true) {
+		AVPacket* pkt = _packet_pool.acquire_packet();
+		int       res = avcodec_receive_packet(_context, pkt);
+		if (res != 0) {
+			_packet_pool.release_packet(pkt);
+			worker_flush_overflow();
+			if ((res == AVERROR(EAGAIN)) || (res == AVERROR_EOF))
+				return true;
+
+			PLOG_ERROR("Failed to receive packet: %s (%ld).", ffmpeg::tools::get_error_description(res),
+			           res);
+			return false;
+		}
+
+		process_packet(*pkt);
+		_worker_overflow.push_back(pkt);
+		packets++;
+		release_frames(1);
+
+		size_t depth = _worker_overflow.size() + _worker_packets->size();
+		if (depth > _pending_packets_peak)
+			_pending_packets_peak = depth;
+	}
 }
 
-std::shared_ptr<AVFrame> obsffmpeg::encoder::pop_used_frame()
+void obsffmpeg::encoder::worker_flush_overflow()
 {
-	auto frame = _used_frames.front();
-	_used_frames.pop();
-	return frame;
+	// Packets are kept locally until the encode thread has room for them, so the worker never blocks on output.
+	while (!_worker_overflow.empty()) {
+		if (!_worker_packets->push(_worker_overflow.front()))
+			break;
+		_worker_overflow.pop_front();
+	}
 }
 
 obsffmpeg::encoder::encoder(obs_data_t* settings, obs_encoder_t* encoder, bool is_texture_encode)
-    : _self(encoder), _lag_in_frames(0), _count_send_frames(0), _have_first_frame(false)
+    : _self(encoder), _lag_in_frames(0), _count_send_frames(0), _have_first_frame(false),
+      _pending_packets_peak(0), _zero_copy(false), _zero_copy_probe(0), _duplicate_mode(duplicate_mode::DISABLED),
+      _duplicate_keepalive(1), _duplicate_run(0), _duplicates_skipped(0), _duplicates_repeated(0), _unique_frames(0),
+      _unique_convert_time(0), _unique_total_time(0), _backpressure(backpressure_mode::DISABLED),
+      _backpressure_frames(0), _backpressure_bytes(0), _frames_held(0), _overloaded(false), _decimate_skip(false),
+      _decimated(false), _backpressure_dropped(0), _backpressure_decimated(0), _backpressure_blocked(0),
+      _backpressure_block_time(0), _scaled(false), _gop_position(0), _keyframe_interval(0), _preset_pending(false),
+      _frame_cache_hits(0), _frame_cache_misses(0), _ladder_hits(0), _ladder_misses(0),
+      _parallel_dts(AV_NOPTS_VALUE),
+      _worker_enabled(false), _worker_stop(false), _worker_failed(false)
 {
 	// Initial set up.
 	_factory = reinterpret_cast<encoder_factory*>(obs_encoder_get_type_data(_self));
@@ -773,9 +1104,8 @@ obsffmpeg::encoder::encoder(obs_data_t* settings, obs_encoder_t* encoder, bool i
 		throw std::runtime_error("failed to create context");
 	}
 
-	// Create 8MB of precached Packet data for use later on.
+	// Packet payloads come from the packet pool where possible, see below.
 	av_init_packet(&_current_packet);
-	av_new_packet(&_current_packet, 8 * 1024 * 1024); // 8 MB precached Packet size.
 
 	if (!is_texture_encode) {
 		initialize_sw(settings);
@@ -810,6 +1140,28 @@ obsffmpeg::encoder::encoder(obs_data_t* settings, obs_encoder_t* encoder, bool i
 		          ffmpeg::tools::get_color_space_name(_swscale.get_target_colorspace()),
 		          _swscale.is_target_full_range() ? "Full" : "Partial");
 	}
+	if (!_hwinst) {
+		PLOG_INFO("[%s]   Conversion Threads: %zu", _codec->name, _threadpool ? _threadpool->size() : 1);
+		PLOG_INFO("[%s]   Conversion Bands: %" PRIu32, _codec->name, _swscale.get_band_count());
+		PLOG_INFO("[%s]   Plane Copy: %s, %zu stripes", _codec->name, _plane_copy.get_kernel_name(),
+		          _plane_copy.get_stripe_count());
+		PLOG_INFO("[%s]   Converter: %s", _codec->name, _converter.get_name());
+		if (_frame_cache) {
+			PLOG_INFO("[%s]   Shared Conversion: %zu subscribers", _codec->name,
+			          _frame_cache->get_subscriber_count());
+		}
+		if (_analysis.is_valid())
+			PLOG_INFO("[%s]   Frame Analysis: Enabled", _codec->name);
+		if (_duplicate_mode == duplicate_mode::SKIP) {
+			PLOG_INFO("[%s]   Duplicate Frames: Skip", _codec->name);
+		} else if (_duplicate_mode == duplicate_mode::REPEAT) {
+			PLOG_INFO("[%s]   Duplicate Frames: Repeat", _codec->name);
+		}
+		if (_roi.is_valid())
+			PLOG_INFO("[%s]   Regions of Interest: Enabled", _codec->name);
+		if (_scene.is_valid())
+			PLOG_INFO("[%s]   Scene Cut Detection: %s", _codec->name, _scene.get_kernel_name());
+	}
 	PLOG_INFO("[%s]   Framerate: %ld/%ld (%f FPS)", _codec->name, _context->time_base.den, _context->time_base.num,
 	          static_cast<double_t>(_context->time_base.den) / static_cast<double_t>(_context->time_base.num));
 	PLOG_INFO("[%s]   Custom Settings: %s", _codec->name, obs_data_get_string(settings, ST_FFMPEG_CUSTOMSETTINGS));
@@ -817,18 +1169,203 @@ obsffmpeg::encoder::encoder(obs_data_t* settings, obs_encoder_t* encoder, bool i
 	// Update settings
 	update(settings);
 
+	// Let the encoder write directly into pooled packet buffers.
+	if (_packet_pool.attach(_context)) {
+		PLOG_INFO("[%s]   Packet Buffers: Pooled", _codec->name);
+	} else {
+		PLOG_INFO("[%s]   Packet Buffers: Encoder", _codec->name);
+	}
+
+	// Encoders of the same canvas at different sizes share one conversion and their keyframes. Only the leader's
+	// forced keyframes keep the renditions aligned, so the encoder must not place any of its own: scene cuts are
+	// turned off, and its interval is set past the forced one, where it only takes over if those stop coming.
+	_keyframe_interval = static_cast<size_t>(std::max(_context->gop_size, 0));
+	const char* ladder_name = obs_data_get_string(settings, ST_FFMPEG_LADDER);
+	if (!is_texture_encode && ladder_name && (ladder_name[0] != '\0')) {
+		_ladder = ladder::join(ladder_name, this, static_cast<uint32_t>(_context->width),
+		                       static_cast<uint32_t>(_context->height), _context->pix_fmt,
+		                       _context->color_range == AVCOL_RANGE_JPEG, _context->colorspace,
+		                       static_cast<uint32_t>(_context->time_base.den),
+		                       static_cast<uint32_t>(_context->time_base.num),
+		                       static_cast<uint32_t>(_keyframe_interval));
+		if (_ladder) {
+			PLOG_INFO("[%s]   Ladder: '%s', %zu members", _codec->name, ladder_name,
+			          _ladder->get_member_count());
+			if (!defer_keyframes()) {
+				PLOG_WARNING("[%s] Encoder may still place keyframes of its own on scene cuts.",
+				             _codec->name);
+			}
+		} else {
+			PLOG_WARNING("[%s] Ladder '%s' encodes a different format, frame rate or keyframe interval, "
+			             "not joining it.",
+			             _codec->name, ladder_name);
+		}
+	}
+
+	// Frames of intra-only codecs don't depend on each other, so they can be encoded on several contexts at once.
+	// The lanes replace the worker thread, and each gets its share of the encoder threads.
+	size_t lanes       = 0;
+	bool   closed_gops = false;
+	size_t frame_lanes = static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_PARALLELFRAMES));
+	if (!is_texture_encode && (frame_lanes > 1)) {
+		if (!is_intra_only(_codec) || ((_codec->capabilities & AV_CODEC_CAP_DELAY) != 0)) {
+			PLOG_WARNING("[%s] Parallel encoding is only available for intra-only encoders.", _codec->name);
+		} else {
+			lanes = frame_lanes;
+		}
+	}
+
+	// Closed GOPs don't depend on each other either, as long as each one starts on a fresh encoder. Every lane
+	// gets a whole keyframe interval, so rate control starts over with its full budget for each GOP.
+	// OBS has no way to take packets once it destroys the encoder, what the lanes hold then is lost. Outputs wait
+	// for the packet of the frame they stopped at, so that is video past the end, but it also delays the stop by
+	// up to a GOP per lane. The number of lanes is limited to keep both within a few seconds.
+	size_t gop_lanes = static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_PARALLELGOPS));
+	if (!is_texture_encode && (lanes == 0) && (gop_lanes > 1)) {
+		if (is_intra_only(_codec) || (_keyframe_interval <= 1)) {
+			PLOG_WARNING("[%s] Parallel GOPs need an encoder with a keyframe interval.", _codec->name);
+		} else {
+			size_t frames = parallel_latency_limit * static_cast<size_t>(_context->time_base.den)
+			                / static_cast<size_t>(std::max(_context->time_base.num, 1));
+			size_t limit  = std::max<size_t>(frames / _keyframe_interval, 1);
+			if (limit < 2) {
+				PLOG_WARNING("[%s] Parallel GOPs need a keyframe interval of at most %d seconds.",
+				             _codec->name, parallel_latency_limit / 2);
+			} else {
+				if (gop_lanes > limit) {
+					PLOG_WARNING("[%s] Parallel GOPs limited to %zu lanes, %d seconds of video.",
+					             _codec->name, limit, parallel_latency_limit);
+				}
+				lanes       = std::min(gop_lanes, limit);
+				closed_gops = true;
+			}
+		}
+	}
+
+	// With lanes, the main context is only the template they are cloned from, so it can do without threads.
+	int lane_threads = _context->thread_count;
+	if (lanes > 1)
+		_context->thread_count = 1;
+
 	// Initialize Encoder
 	int res = avcodec_open2(_context, _codec, NULL);
 	if (res < 0) {
+		if (_ladder)
+			_ladder->leave(this);
 		std::stringstream sstr;
 		sstr << "Initializing encoder '" << _codec->name
 		     << "' failed with error: " << ffmpeg::tools::get_error_description(res) << " (code " << res << ")";
 		throw std::runtime_error(sstr.str());
 	}
+
+	if (lanes > 1) {
+		int threads = std::max(1, lane_threads / static_cast<int>(lanes));
+		_parallel.initialize(lanes, closed_gops ? _keyframe_interval : 1, closed_gops,
+		                     [this, threads, closed_gops]() { return clone_context(threads, closed_gops); },
+		                     &_packet_pool);
+		if (closed_gops) {
+			PLOG_INFO("[%s]   Parallel GOPs: %zu lanes, %zu frames each", _codec->name,
+			          _parallel.get_lane_count(), _keyframe_interval);
+		} else {
+			PLOG_INFO("[%s]   Parallel Frames: %zu lanes", _codec->name, _parallel.get_lane_count());
+		}
+	}
+
+	// Move encoding off of the OBS encode thread if requested.
+	_worker_enabled = !is_texture_encode && !_parallel.is_valid()
+	                  && obs_data_get_bool(settings, ST_FFMPEG_WORKERTHREAD);
+	if (_worker_enabled) {
+		PLOG_INFO("[%s]   Worker Thread: Enabled", _codec->name);
+		start_worker();
+	}
+
+	// OBS only guarantees the input memory for the duration of the encode call, so frames can only be passed
+	// through as-is if the encoder is guaranteed to be done with them before we return. The leader of a ladder
+	// converts frames that have to outlive the encode call, so there is no zero-copy in a ladder.
+	_zero_copy = !is_texture_encode && !_worker_enabled && !_parallel.is_valid() && !_ladder
+	             && (_swscale.is_source_full_range() == _swscale.is_target_full_range())
+	             && (_swscale.get_source_colorspace() == _swscale.get_target_colorspace())
+	             && (_swscale.get_source_format() == _swscale.get_target_format())
+	             && ((_codec->capabilities & AV_CODEC_CAP_DELAY) == 0)
+	             && ((_context->active_thread_type & FF_THREAD_FRAME) == 0);
+	if (_zero_copy) {
+		PLOG_INFO("[%s]   Zero-Copy: Enabled", _codec->name);
+		_zero_copy_probe = zerocopy_probe_frames;
+	}
+
+	// Rather change the resolution or preset than stall when the encoder can't keep up. Encode time is only
+	// visible here without the worker thread.
+	if (!is_texture_encode && obs_data_get_bool(settings, ST_FFMPEG_RESOLUTIONGOVERNOR)) {
+		if (_worker_enabled || _parallel.is_valid()) {
+			PLOG_WARNING("[%s] Resolution governor is not available with the worker thread or parallel "
+			             "frames.",
+			             _codec->name);
+		} else if (_ladder) {
+			PLOG_WARNING("[%s] Resolution governor is not available in a ladder.", _codec->name);
+		} else if (_context->extradata_size > 0) {
+			// Muxers write global headers once at the start, a new size would never reach the decoder.
+			PLOG_WARNING("[%s] Resolution governor is not available, the encoder uses global headers.",
+			             _codec->name);
+		} else {
+			_governor.initialize(_context->width, _context->height, _context->time_base.den,
+			                     _context->time_base.num);
+			if (_governor.is_valid()) {
+				PLOG_INFO("[%s]   Resolution Governor: %zu levels", _codec->name,
+				          _governor.get_level_count());
+			}
+		}
+	}
+	if (_presets.is_valid()) {
+		if (_worker_enabled || _parallel.is_valid()) {
+			PLOG_WARNING("[%s] Preset governor is not available with the worker thread or parallel frames.",
+			             _codec->name);
+			_presets.initialize(nullptr, 0, 0);
+		} else {
+			PLOG_INFO("[%s]   Preset Governor: %zu levels", _codec->name, _presets.get_level_count());
+		}
+	}
+
+	// Bound the frames held by the encoder and the worker queue. The automatic limit leaves room for both.
+	if (!is_texture_encode) {
+		_backpressure = static_cast<backpressure_mode>(obs_data_get_int(settings, ST_FFMPEG_BACKPRESSURE));
+		_backpressure_frames = static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_BACKPRESSUREFRAMES));
+		_backpressure_bytes =
+		    static_cast<size_t>(obs_data_get_int(settings, ST_FFMPEG_BACKPRESSUREMEMORY)) << 20;
+		if (_backpressure_frames == 0)
+			_backpressure_frames = _lag_in_frames + (_worker_enabled ? worker_frame_queue_size : 0)
+			                       + _parallel.get_frame_capacity() + 2;
+		if (_backpressure != backpressure_mode::DISABLED) {
+			PLOG_INFO("[%s]   Backpressure: %s, %zu frames, %zu MiB", _codec->name,
+			          (_backpressure == backpressure_mode::DROP)
+			              ? "Drop"
+			              : ((_backpressure == backpressure_mode::DECIMATE) ? "Decimate" : "Block"),
+			          _backpressure_frames, _backpressure_bytes >> 20);
+		}
+	}
+
+	// Have enough frames ready for the encoder to fill its lookahead without allocating.
+	if (!is_texture_encode) {
+		size_t frames = _lag_in_frames + _parallel.get_lane_count() + 1;
+		_frame_pool.set_high_water(frames);
+		if (!_zero_copy)
+			_frame_pool.prewarm(frames);
+	}
 }
 
 obsffmpeg::encoder::~encoder()
 {
+	stop_worker();
+
+	// Whatever the lanes still hold has nowhere to go anymore, so they are stopped instead of waited for. The
+	// amount is bounded by the lane limit in the constructor.
+	if (_parallel.is_valid()) {
+		PLOG_INFO("[%s] Parallel encoding: %llu segments, waited %.1f ms for lanes, discarded %zu unfinished.",
+		          _codec->name, _parallel.get_segment_count(),
+		          std::chrono::duration<double_t, std::milli>(_parallel.get_wait_time()).count(),
+		          _parallel.get_pending_segments());
+		_parallel.finalize();
+	}
+
 	if (_context) {
 		// Flush encoders that require it.
 		if ((_codec->capabilities & AV_CODEC_CAP_DELAY) != 0) {
@@ -844,8 +1381,66 @@ obsffmpeg::encoder::~encoder()
 		avcodec_free_context(&_context);
 	}
 
+	PLOG_INFO("[%s] Pending packet queue peaked at %zu packets.", _codec->name, _pending_packets_peak);
+	for (auto ptr : _pending_packets) {
+		_packet_pool.release_packet(ptr);
+	}
+	_pending_packets.clear();
+
 	av_packet_unref(&_current_packet);
 
+	auto stats = _frame_pool.get_statistics();
+	PLOG_INFO("[%s] Frame pool: %llu hits, %llu misses, %llu trims, %zu bytes held.", _codec->name,
+	          stats.hits, stats.misses, stats.trims, stats.bytes_held);
+	if (stats.held > 0) {
+		auto usage = _frame_pool.get_key_usage();
+		PLOG_INFO("[%s]   %s %" PRIu32 "x%" PRIu32 ": %zu of %zu buffers in use, %zu MiB held by %zu pools.",
+		          _codec->name, ffmpeg::tools::get_pixel_format_name(usage.key.format), usage.key.width,
+		          usage.key.height, usage.in_use, usage.held, usage.bytes_held >> 20, usage.users);
+	}
+
+	if (_duplicate_mode != duplicate_mode::DISABLED) {
+		auto dstats = get_duplicate_statistics();
+		PLOG_INFO("[%s] Duplicate frames: %llu unique, %llu skipped, %llu repeated, about %.1f ms saved.",
+		          _codec->name, dstats.unique, dstats.skipped, dstats.repeated, dstats.saved_ms);
+	}
+	_last_frame = nullptr;
+
+	if (_backpressure != backpressure_mode::DISABLED) {
+		PLOG_INFO("[%s] Backpressure: %llu dropped, %llu decimated, %llu blocked for %.1f ms.", _codec->name,
+		          _backpressure_dropped, _backpressure_decimated, _backpressure_blocked,
+		          std::chrono::duration<double_t, std::milli>(_backpressure_block_time).count());
+	}
+
+	if (_frame_cache) {
+		PLOG_INFO("[%s] Shared conversion: %llu frames taken from other encoders, %llu converted.",
+		          _codec->name, _frame_cache_hits, _frame_cache_misses);
+		_frame_cache->unsubscribe();
+		_frame_cache = nullptr;
+	}
+
+	if (_ladder) {
+		PLOG_INFO("[%s] Ladder: %llu frames taken from the leader, %llu converted.", _codec->name, _ladder_hits,
+		          _ladder_misses);
+		_ladder->leave(this);
+		_ladder = nullptr;
+	}
+
+	if (_governor.is_valid()) {
+		PLOG_INFO("[%s] Resolution governor: %llu switches, ended at level %zu.", _codec->name,
+		          _governor.get_switch_count(), _governor.get_level());
+	}
+
+	if (_presets.is_valid()) {
+		PLOG_INFO("[%s] Preset governor: %llu switches, ended at level %zu.", _codec->name,
+		          _presets.get_switch_count(), _presets.get_level());
+	}
+
+	if (_scene.is_valid()) {
+		PLOG_INFO("[%s] Scene cut detection: %llu cuts, %.1f us per frame.", _codec->name,
+		          _scene.get_cut_count(), _scene.get_average_time_us());
+	}
+
 	_swscale.finalize();
 }
 
@@ -862,6 +1457,23 @@ void obsffmpeg::encoder::get_properties(obs_properties_t* props, bool hw_encode)
 	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_COLORFORMAT), false);
 	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_THREADS), false);
 	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_STANDARDCOMPLIANCE), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_WORKERTHREAD), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_PARALLELFRAMES), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_PARALLELGOPS), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_CONVERSIONTHREADS), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_CONVERSIONBANDS), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_SHAREDCONVERSION), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_FRAMEANALYSIS), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_DUPLICATEFRAMES), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_REGIONOFINTEREST), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_SCENECUTTHRESHOLD), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_SCENECUTDISTANCE), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_RESOLUTIONGOVERNOR), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_PRESETLEVELS), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_BACKPRESSURE), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_BACKPRESSUREFRAMES), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_BACKPRESSUREMEMORY), false);
+	obs_property_set_enabled(obs_properties_get(props, ST_FFMPEG_LADDER), false);
 }
 
 bool obsffmpeg::encoder::update(obs_data_t* settings)
@@ -921,6 +1533,12 @@ bool obsffmpeg::encoder::update(obs_data_t* settings)
 		                       nullptr, "=", ";");
 	}
 
+	// The preset governor's options go on top, so they are kept when the encoder is reopened.
+	if (_presets.is_valid()) {
+		av_opt_set_from_string(_context->priv_data, _presets.get_options().c_str(), nullptr, "=", ";");
+		_preset_options = _presets.get_options();
+	}
+
 	if (_handler)
 		_handler->override_lag_in_frames(_lag_in_frames, settings, _codec, _context);
 
@@ -970,39 +1588,545 @@ bool obsffmpeg::encoder::get_extra_data(uint8_t** data, size_t* size)
 	return true;
 }
 
-static inline void copy_data(encoder_frame* frame, AVFrame* vframe)
+static inline bool is_zero_copy_compatible(encoder_frame* frame)
 {
+	for (size_t idx = 0; idx < MAX_AV_PLANES; idx++) {
+		if ((reinterpret_cast<uintptr_t>(frame->data[idx]) % zerocopy_alignment)
+		    || (frame->linesize[idx] % zerocopy_alignment))
+			return false;
+	}
+	return true;
+}
+
+static void zero_copy_free(void*, uint8_t*)
+{
+	// The memory is owned by OBS.
+}
+
+static std::shared_ptr<AVFrame> wrap_data(encoder_frame* frame, int width, int height, AVPixelFormat format)
+{
+	std::shared_ptr<AVFrame> vframe = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* frame) {
+		av_frame_unref(frame);
+		av_frame_free(&frame);
+	});
+	if (!vframe)
+		throw std::runtime_error("Failed to allocate frame.");
+
+	vframe->width         = width;
+	vframe->height        = height;
+	vframe->format        = format;
+	vframe->extended_data = vframe->data;
+
 	int h_chroma_shift, v_chroma_shift;
-	av_pix_fmt_get_chroma_sub_sample(static_cast<AVPixelFormat>(vframe->format), &h_chroma_shift, &v_chroma_shift);
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift, &v_chroma_shift);
 
-	for (size_t idx = 0; idx < MAX_AV_PLANES; idx++) {
-		if (!frame->data[idx] || !vframe->data[idx])
-			continue;
+	for (size_t idx = 0; (idx < MAX_AV_PLANES) && (idx < AV_NUM_DATA_POINTERS); idx++) {
+		if (!frame->data[idx])
+			break;
 
-		size_t plane_height = vframe->height >> (idx ? v_chroma_shift : 0);
+		int plane_height = ((idx == 1) || (idx == 2)) ? AV_CEIL_RSHIFT(height, v_chroma_shift) : height;
 
-		if (static_cast<uint32_t>(vframe->linesize[idx]) == frame->linesize[idx]) {
-			std::memcpy(vframe->data[idx], frame->data[idx], frame->linesize[idx] * plane_height);
-		} else {
-			size_t ls_in  = frame->linesize[idx];
-			size_t ls_out = vframe->linesize[idx];
-			size_t bytes  = ls_in < ls_out ? ls_in : ls_out;
+		vframe->data[idx]     = frame->data[idx];
+		vframe->linesize[idx] = static_cast<int>(frame->linesize[idx]);
 
-			uint8_t* to   = vframe->data[idx];
-			uint8_t* from = frame->data[idx];
+		// Read-only, so that anything wanting to modify the frame has to make a copy first.
+		vframe->buf[idx] = av_buffer_create(frame->data[idx], vframe->linesize[idx] * plane_height,
+		                                    zero_copy_free, nullptr, AV_BUFFER_FLAG_READONLY);
+		if (!vframe->buf[idx])
+			throw std::runtime_error("Failed to wrap frame data.");
+	}
 
-			for (size_t y = 0; y < plane_height; y++) {
-				std::memcpy(to, from, bytes);
-				to += ls_out;
-				from += ls_in;
+	return vframe;
+}
+
+bool obsffmpeg::encoder::admit_frame()
+{
+	// Pool statistics miss frames from the cache, the ladder and zero copy, and count those held by other users of
+	// the same pool, so count what was handed to the queue, the lanes or the codec without a packet back instead.
+	struct held {
+		size_t in_use;
+		size_t bytes_in_use;
+	};
+	size_t frame_size = static_cast<size_t>(
+	    std::max(0, av_image_get_buffer_size(_context->pix_fmt, _context->width, _context->height, 1)));
+	auto get_held = [this, frame_size]() {
+		size_t frames = _frames_held;
+		return held{frames, frames * frame_size};
+	};
+	auto is_over = [this](held const& stats) {
+		return (stats.in_use >= _backpressure_frames)
+		       || ((_backpressure_bytes > 0) && (stats.bytes_in_use >= _backpressure_bytes));
+	};
+	auto stats = get_held();
+	bool over  = is_over(stats);
+	_decimated = false;
+
+	// Give the encoder a chance to release frames first, draining its output meanwhile if nobody else does.
+	if ((_backpressure == backpressure_mode::BLOCK) && over) {
+		auto begin    = std::chrono::high_resolution_clock::now();
+		auto deadline = begin + std::chrono::milliseconds(backpressure_block_timeout);
+		while (over && (std::chrono::high_resolution_clock::now() < deadline)) {
+			if (!_worker_enabled && !_parallel.is_valid()) {
+				size_t packets = 0;
+				receive_packets(packets);
 			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			stats = get_held();
+			over  = is_over(stats);
 		}
+		_backpressure_blocked++;
+		_backpressure_block_time += std::chrono::high_resolution_clock::now() - begin;
+	}
+
+	// Stay in the overloaded state until half of the limit is free again, so that it doesn't flip every frame.
+	if (over && !_overloaded) {
+		_overloaded = true;
+		PLOG_WARNING("[%s] Encoder holds %zu frames (%zu MiB), %s.", _codec->name, stats.in_use,
+		             stats.bytes_in_use >> 20,
+		             (_backpressure == backpressure_mode::DECIMATE) ? "halving the frame rate"
+		                                                          : "dropping new frames");
+	} else if (_overloaded && (stats.in_use <= (_backpressure_frames / 2))
+	           && ((_backpressure_bytes == 0) || (stats.bytes_in_use <= (_backpressure_bytes / 2)))) {
+		_overloaded = false;
+		PLOG_INFO("[%s] Encoder caught up, %llu frames dropped and %llu decimated so far.", _codec->name,
+		          _backpressure_dropped, _backpressure_decimated);
+	}
+	if (!_overloaded)
+		return true;
+
+	// Decimation only drops frames for good at the hard limit, the rest of the time every other one is kept.
+	if ((_backpressure == backpressure_mode::DECIMATE) && !over) {
+		_decimate_skip = !_decimate_skip;
+		if (_decimate_skip) {
+			_backpressure_decimated++;
+			return false;
+		}
+		_decimated = true;
+		return true;
+	}
+
+	if (!over)
+		return true;
+
+	_backpressure_dropped++;
+	return false;
+}
+
+void obsffmpeg::encoder::release_frames(size_t count)
+{
+	// Codecs may return a packet for a frame that was skipped, so never go below zero.
+	size_t held = _frames_held;
+	while (!_frames_held.compare_exchange_weak(held, (held > count) ? (held - count) : 0)) {
 	}
 }
 
+void obsffmpeg::encoder::attach_analysis(AVFrame* frame)
+{
+	// Regions are in input coordinates, which no longer match once the frame is scaled.
+	_analysis.attach(frame);
+	if (_roi.is_valid() && !_scaled)
+		_roi.apply(frame, _analysis.get_result());
+}
+
+void obsffmpeg::encoder::govern(std::chrono::nanoseconds time)
+{
+	_unique_frames++;
+	_unique_total_time += time;
+
+	if (_governor.is_valid() && _governor.update(time)) {
+		auto size = _governor.get_size();
+		PLOG_INFO("[%s] Encoder load is at %.0f%%, switching to level %zu (%" PRIu32 "x%" PRIu32 ").",
+		          _codec->name, _governor.get_load() * 100.0, _governor.get_level(), size.first, size.second);
+		reconfigure(size.first, size.second);
+		return;
+	}
+
+	if (_presets.is_valid() && _presets.update(time)) {
+		PLOG_INFO("[%s] Encoder load is at %.0f%%, switching to preset level %zu (%s).", _codec->name,
+		          _presets.get_load() * 100.0, _presets.get_level(), _presets.get_options().c_str());
+		if (apply_runtime_options(_presets.get_options())) {
+			PLOG_INFO("[%s] Preset level applied to the running encoder.", _codec->name);
+			_preset_pending = false;
+		} else {
+			PLOG_INFO("[%s] Preset level needs the encoder to be reopened, waiting for the next keyframe.",
+			          _codec->name);
+			_preset_pending = true;
+		}
+	}
+
+	advance_gop();
+}
+
+void obsffmpeg::encoder::advance_gop()
+{
+	_gop_position++;
+
+	// Reopen where the encoder would start a new GOP anyway, so that no extra keyframe is spent on it.
+	bool gop_end = (_keyframe_interval <= 1) || (_gop_position >= _keyframe_interval);
+	if (gop_end)
+		_gop_position = 0;
+	if (_preset_pending && gop_end) {
+		PLOG_INFO("[%s] Reopening encoder for preset level %zu.", _codec->name, _presets.get_level());
+		reconfigure(static_cast<uint32_t>(_context->width), static_cast<uint32_t>(_context->height));
+	}
+}
+
+bool obsffmpeg::encoder::defer_keyframes()
+{
+	if (_keyframe_interval > 1) {
+		_context->gop_size   = static_cast<int>(_keyframe_interval * 2);
+		_context->keyint_min = _context->gop_size;
+	}
+	return disable_scene_cut(_codec, _context);
+}
+
+bool obsffmpeg::encoder::apply_runtime_options(const std::string& options)
+{
+	AVDictionary* dict    = nullptr;
+	AVDictionary* current = nullptr;
+	if ((av_dict_parse_string(&dict, options.c_str(), "=", ";", 0) < 0)
+	    || (av_dict_parse_string(&current, _preset_options.c_str(), "=", ";", 0) < 0)) {
+		av_dict_free(&dict);
+		av_dict_free(&current);
+		return false;
+	}
+
+	// A key the new level leaves out would keep the value of the old level instead of going back to the
+	// settings, only reopening the encoder resets it. So the levels have to set the same keys.
+	bool               runtime = (av_dict_count(dict) == av_dict_count(current));
+	AVDictionaryEntry* entry   = nullptr;
+	while (runtime && ((entry = av_dict_get(current, "", entry, AV_DICT_IGNORE_SUFFIX)) != nullptr)) {
+		if (!av_dict_get(dict, entry->key, nullptr, 0))
+			runtime = false;
+	}
+	av_dict_free(&current);
+
+	// All or nothing, a partially applied level would be neither the old nor the new one.
+	entry = nullptr;
+	while (runtime && ((entry = av_dict_get(dict, "", entry, AV_DICT_IGNORE_SUFFIX)) != nullptr)) {
+		const AVOption* opt = av_opt_find(_context->priv_data, entry->key, nullptr, 0, 0);
+		if (!opt || ((opt->flags & AV_OPT_FLAG_RUNTIME_PARAM) == 0))
+			runtime = false;
+	}
+	if (runtime) {
+		while ((entry = av_dict_get(dict, "", entry, AV_DICT_IGNORE_SUFFIX)) != nullptr) {
+			av_opt_set(_context->priv_data, entry->key, entry->value, 0);
+		}
+		_preset_options = options;
+	}
+
+	av_dict_free(&dict);
+	return runtime;
+}
+
+// Copies what describes the video itself, which is not covered by the codec options.
+static void copy_video_parameters(AVCodecContext* target, const AVCodecContext* source)
+{
+	target->width                  = source->width;
+	target->height                 = source->height;
+	target->pix_fmt                = source->pix_fmt;
+	target->color_range            = source->color_range;
+	target->color_primaries        = source->color_primaries;
+	target->color_trc              = source->color_trc;
+	target->colorspace             = source->colorspace;
+	target->chroma_sample_location = source->chroma_sample_location;
+	target->field_order            = source->field_order;
+	target->ticks_per_frame        = source->ticks_per_frame;
+	target->sample_aspect_ratio    = source->sample_aspect_ratio;
+	target->framerate              = source->framerate;
+	target->time_base              = source->time_base;
+}
+
+void obsffmpeg::encoder::reconfigure(uint32_t width, uint32_t height)
+{
+	// Drain the old encoder, its packets are handed out as usual with the next calls.
+	if ((_codec->capabilities & AV_CODEC_CAP_DELAY) != 0) {
+		avcodec_send_frame(_context, nullptr);
+		size_t packets = 0;
+		int    res     = receive_packets(packets);
+		if (res != AVERROR_EOF) {
+			PLOG_ERROR("[%s] Failed to drain encoder: %s (%ld).", _codec->name,
+			           ffmpeg::tools::get_error_description(res), res);
+		}
+	}
+	_frames_held = 0;
+
+	// The size of an open encoder is fixed, so replace it with a new one that has the same settings. Its first
+	// frame is an IDR frame, and the parameter sets in front of it announce the new size.
+	int             reorder = _context->has_b_frames;
+	AVCodecContext* context = avcodec_alloc_context3(_codec);
+	if (!context)
+		throw std::runtime_error("Failed to create context for new resolution.");
+	copy_video_parameters(context, _context);
+	context->width  = static_cast<int>(width);
+	context->height = static_cast<int>(height);
+	avcodec_free_context(&_context);
+	_context = context;
+
+	obs_data_t* settings = obs_encoder_get_settings(_self);
+	update(settings);
+	obs_data_release(settings);
+	if (_ladder)
+		defer_keyframes();
+	_packet_pool.attach(_context);
+
+	int res = avcodec_open2(_context, _codec, NULL);
+	if (res < 0) {
+		std::stringstream sstr;
+		sstr << "Reopening encoder '" << _codec->name << "' at " << width << "x" << height
+		     << " failed with error: " << ffmpeg::tools::get_error_description(res) << " (code " << res << ")";
+		throw std::runtime_error(sstr.str());
+	}
+	_gop_position   = 0;
+	_preset_pending = false;
+
+	// Decode timestamps only continue smoothly if the new encoder delays frames by as much as the old one did.
+	if (_context->has_b_frames > reorder) {
+		PLOG_WARNING("[%s] Encoder now reorders %d instead of %d frames, decode timestamps may step backwards.",
+		             _codec->name, _context->has_b_frames, reorder);
+	}
+
+	// Frames of the old size are of no use anymore.
+	_scaled = (width != _swscale.get_source_width()) || (height != _swscale.get_source_height());
+	_swscale.finalize();
+	_swscale.set_target_size(width, height);
+	if (!_swscale.initialize(_scaled ? SWS_FAST_BILINEAR : SWS_POINT))
+		throw std::runtime_error("Failed to initialize scaler for new resolution.");
+	_frame_pool.set_resolution(width, height);
+	_frame_pool.prewarm(_lag_in_frames + 1);
+	_last_frame = nullptr;
+
+	// The parameter sets in front of the next keyframe describe the new encoder, take the extra data from them
+	// again so that outputs started from now on get headers that match the stream.
+	_have_first_frame = false;
+}
+
+AVCodecContext* obsffmpeg::encoder::clone_context(int threads, bool closed_gops)
+{
+	AVCodecContext* context = avcodec_alloc_context3(_codec);
+	if (!context)
+		throw std::runtime_error("Failed to create context for parallel encoding.");
+
+	// Everything the handler and the custom settings changed went through the options, so copying those and the
+	// video parameters gives an identical encoder.
+	int res = av_opt_copy(context, _context);
+	if ((res >= 0) && _codec->priv_class)
+		res = av_opt_copy(context->priv_data, _context->priv_data);
+	if (res < 0) {
+		avcodec_free_context(&context);
+		throw std::runtime_error("Failed to copy encoder options for parallel encoding.");
+	}
+	copy_video_parameters(context, _context);
+
+	// Single frames can't have packets held back by frame threads, whole GOPs are drained at the end anyway.
+	if (!closed_gops)
+		context->thread_type = (_codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) ? FF_THREAD_SLICE : 0;
+	context->thread_count = threads;
+	_packet_pool.attach(context);
+
+	res = avcodec_open2(context, _codec, NULL);
+	if (res < 0) {
+		avcodec_free_context(&context);
+		std::stringstream sstr;
+		sstr << "Initializing parallel encoder '" << _codec->name
+		     << "' failed with error: " << ffmpeg::tools::get_error_description(res) << " (code " << res << ")";
+		throw std::runtime_error(sstr.str());
+	}
+
+	// Every lane starts a stream of its own, which only fit together if they announce the same parameters. The
+	// first lane is the reference, the main context runs with other threading and may differ.
+	std::vector<uint8_t> extra_data(context->extradata, context->extradata + context->extradata_size);
+	if (!_parallel_extra_data) {
+		_parallel_extra_data = std::make_shared<std::vector<uint8_t>>(std::move(extra_data));
+	} else if (*_parallel_extra_data != extra_data) {
+		avcodec_close(context);
+		avcodec_free_context(&context);
+		throw std::runtime_error("Parallel encoder has different extra data than the first one.");
+	}
+	return context;
+}
+
+// Duration of a frame in units of the time base, which is one frame interval.
+static void set_frame_duration(AVFrame* frame, int64_t duration)
+{
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 30, 100)
+	frame->duration = duration;
+#else
+	frame->pkt_duration = duration;
+#endif
+}
+
+// A reference to the converted frame for other encoders, without what only applies to this one.
+static std::shared_ptr<AVFrame> share_frame(AVFrame* frame)
+{
+	std::shared_ptr<AVFrame> shared(av_frame_clone(frame), [](AVFrame* frame) { av_frame_free(&frame); });
+	if (!shared)
+		throw std::runtime_error("Failed to reference frame for sharing.");
+	shared->pict_type = AV_PICTURE_TYPE_NONE;
+	set_frame_duration(shared.get(), 0);
+	return shared;
+}
+
 bool obsffmpeg::encoder::video_encode(encoder_frame* frame, encoder_packet* packet, bool* received_packet)
 {
-	std::shared_ptr<AVFrame> vframe = pop_free_frame(); // Retrieve an empty frame.
+	convert::frame_analysis* analysis = _analysis.is_valid() ? &_analysis : nullptr;
+	auto                     begin    = std::chrono::high_resolution_clock::now();
+
+	// Duplicates have to be found before anything else happens to the frame, skipping or repeating them saves the
+	// conversion as well. This costs us the hashing fused into the conversion, so hash everything up front.
+	bool hashed = false;
+	if (analysis && (_duplicate_mode != duplicate_mode::DISABLED)) {
+		analysis->hash_plane(frame->data[0], frame->linesize[0], _threadpool);
+		for (size_t idx = 1; (idx < MAX_AV_PLANES) && frame->data[idx]; idx++) {
+			analysis->hash_other_plane(idx, frame->data[idx], frame->linesize[idx]);
+		}
+		analysis->finish();
+		hashed = true;
+
+		if (analysis->get_result()->is_duplicate()) {
+			if ((_duplicate_mode == duplicate_mode::SKIP) && (_duplicate_run < _duplicate_keepalive)) {
+				_duplicate_run++;
+				_duplicates_skipped++;
+				return skip_avframe(packet, received_packet);
+			} else if ((_duplicate_mode == duplicate_mode::REPEAT) && _last_frame) {
+				std::shared_ptr<AVFrame> vframe(av_frame_clone(_last_frame.get()),
+				                                [](AVFrame* frame) { av_frame_free(&frame); });
+				if (!vframe)
+					throw std::runtime_error("Failed to reference previous frame.");
+				vframe->pts       = frame->pts;
+				vframe->pict_type = AV_PICTURE_TYPE_NONE;
+				attach_analysis(vframe.get());
+
+				// The encoder counts the repeat like any other frame, so the keyframes the leader of a
+				// ladder places have to as well, and may land on a repeat.
+				if ((_gop_position == 0) && _ladder && _ladder->is_leader(this))
+					vframe->pict_type = AV_PICTURE_TYPE_I;
+				_duplicates_repeated++;
+				bool res = dispatch_avframe(vframe, packet, received_packet);
+				advance_gop();
+				return res;
+			}
+		}
+		_duplicate_run = 0;
+	}
+
+	// Dropped frames are never analysed, so the scene cut detection compares against the last encoded one.
+	if ((_backpressure != backpressure_mode::DISABLED) && !admit_frame())
+		return skip_avframe(packet, received_packet);
+
+	// Followers in a ladder encode what the leader converted and scaled for them during this video frame, and
+	// place their keyframes where the leader did.
+	bool leader = _ladder && _ladder->is_leader(this);
+	if (_ladder && !leader) {
+		bool                     keyframe = false;
+		std::shared_ptr<AVFrame> level =
+		    _ladder->fetch(this, frame->data[0], static_cast<uint32_t>(_context->width),
+		                   static_cast<uint32_t>(_context->height), keyframe);
+		if (level) {
+			std::shared_ptr<AVFrame> vframe(av_frame_clone(level.get()),
+			                                [](AVFrame* frame) { av_frame_free(&frame); });
+			if (!vframe)
+				throw std::runtime_error("Failed to reference ladder frame.");
+			vframe->pts       = frame->pts;
+			vframe->pict_type = keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+			if (_decimated)
+				set_frame_duration(vframe.get(), 2);
+			_ladder_hits++;
+
+			if (_duplicate_mode == duplicate_mode::REPEAT)
+				_last_frame = vframe;
+
+			bool res = dispatch_avframe(vframe, packet, received_packet);
+			govern(std::chrono::high_resolution_clock::now() - begin);
+			return res;
+		}
+		_ladder_misses++;
+	}
+
+	// Looked for on the input, so that the keyframe lands on the first frame of the new scene.
+	bool scene_cut = _scene.is_valid() && _scene.analyse(frame->data[0], frame->linesize[0]);
+	if (scene_cut)
+		_gop_position = 0;
+
+	// The leader places the keyframes of the whole ladder itself, instead of leaving it to its encoder.
+	if (leader && (_gop_position == 0))
+		scene_cut = true;
+
+	if (_zero_copy && !_scaled && is_zero_copy_compatible(frame)) {
+		// Encoders like qtrle and gif keep the previous input around, which would then point at memory OBS
+		// already reused. The first frames are copied to find out, and only passed as-is if none were kept.
+		bool                     probe = _zero_copy_probe > 0;
+		std::shared_ptr<AVFrame> vframe;
+		if (probe) {
+			vframe         = _frame_pool.get();
+			vframe->height = _context->height;
+			vframe->format = _context->pix_fmt;
+			_plane_copy.copy(frame->data, frame->linesize, vframe->data, vframe->linesize, nullptr);
+		} else {
+			vframe = wrap_data(frame, _context->width, _context->height, _swscale.get_source_format());
+		}
+		vframe->color_range     = _context->color_range;
+		vframe->colorspace      = _context->colorspace;
+		vframe->color_primaries = _context->color_primaries;
+		vframe->color_trc       = _context->color_trc;
+		vframe->pts             = frame->pts;
+		if (scene_cut)
+			vframe->pict_type = AV_PICTURE_TYPE_I;
+		if (_decimated)
+			set_frame_duration(vframe.get(), 2);
+
+		if (analysis) {
+			if (!hashed) {
+				analysis->hash_plane(frame->data[0], frame->linesize[0], _threadpool);
+				analysis->finish();
+			}
+			attach_analysis(vframe.get());
+		}
+
+		// The frame points at OBS memory, so it can't be repeated later.
+		_last_frame = nullptr;
+
+		bool res = encode_avframe(vframe, packet, received_packet);
+
+		// Anything still referencing the frame now came from the encoder.
+		for (size_t idx = 0; idx < AV_NUM_DATA_POINTERS; idx++) {
+			if (vframe->buf[idx] && (av_buffer_get_ref_count(vframe->buf[idx]) > 1)) {
+				if (probe) {
+					PLOG_INFO("[%s] Encoder keeps its input frames, disabling zero-copy.",
+					          _codec->name);
+				} else {
+					PLOG_WARNING("[%s] Encoder kept a reference to an input frame, disabling "
+					             "zero-copy.",
+					             _codec->name);
+				}
+				_zero_copy = false;
+				break;
+			}
+		}
+		if (probe && _zero_copy)
+			_zero_copy_probe--;
+
+		govern(std::chrono::high_resolution_clock::now() - begin);
+		return res;
+	}
+
+	// Another encoder may have converted this very input the same way already.
+	std::shared_ptr<AVFrame> vframe;
+	bool                     cached = false;
+	if (_frame_cache && !_scaled) {
+		std::shared_ptr<AVFrame> shared = _frame_cache->find(frame->data[0]);
+		if (shared) {
+			vframe.reset(av_frame_clone(shared.get()), [](AVFrame* frame) { av_frame_free(&frame); });
+			if (!vframe)
+				throw std::runtime_error("Failed to reference shared frame.");
+			cached = true;
+			_frame_cache_hits++;
+		} else {
+			_frame_cache_misses++;
+		}
+	}
+	if (!vframe)
+		vframe = _frame_pool.get(); // Retrieve an empty frame.
 
 	// Convert frame.
 	{
@@ -1010,6 +2134,9 @@ bool obsffmpeg::encoder::video_encode(encoder_frame* frame, encoder_packet* pack
 		ScopeProfiler profile("convert");
 #endif
 
+		// Rows are only hashed along with the conversion if that didn't already happen above.
+		convert::frame_analysis* fused = hashed ? nullptr : analysis;
+
 		vframe->height          = _context->height;
 		vframe->format          = _context->pix_fmt;
 		vframe->color_range     = _context->color_range;
@@ -1017,27 +2144,61 @@ bool obsffmpeg::encoder::video_encode(encoder_frame* frame, encoder_packet* pack
 		vframe->color_primaries = _context->color_primaries;
 		vframe->color_trc       = _context->color_trc;
 		vframe->pts             = frame->pts;
-
-		if ((_swscale.is_source_full_range() == _swscale.is_target_full_range())
+		if (scene_cut)
+			vframe->pict_type = AV_PICTURE_TYPE_I;
+		if (_decimated)
+			set_frame_duration(vframe.get(), 2);
+
+		// Only swscale can change the size of the frame.
+		if (cached) {
+			// Nothing left to do but the analysis.
+			if (fused)
+				fused->hash_plane(frame->data[0], frame->linesize[0], _threadpool);
+		} else if (!_scaled && (_swscale.is_source_full_range() == _swscale.is_target_full_range())
 		    && (_swscale.get_source_colorspace() == _swscale.get_target_colorspace())
 		    && (_swscale.get_source_format() == _swscale.get_target_format())) {
-			copy_data(frame, vframe.get());
+			_plane_copy.copy(frame->data, frame->linesize, vframe->data, vframe->linesize, fused);
+		} else if (!_scaled && _converter.is_valid()) {
+			_converter.convert(frame->data, reinterpret_cast<int*>(frame->linesize), vframe->data,
+			                   vframe->linesize, fused);
 		} else {
+			if (fused)
+				fused->hash_plane(frame->data[0], frame->linesize[0], _threadpool);
+
+			// The slice is the whole input frame, which is larger than the encoder's once scaled.
 			int res = _swscale.convert(reinterpret_cast<uint8_t**>(frame->data),
-			                           reinterpret_cast<int*>(frame->linesize), 0, _context->height,
-			                           vframe->data, vframe->linesize);
+			                           reinterpret_cast<int*>(frame->linesize), 0,
+			                           static_cast<int32_t>(_swscale.get_source_height()), vframe->data,
+			                           vframe->linesize);
 			if (res <= 0) {
 				PLOG_ERROR("Failed to convert frame: %s (%ld).",
 				           ffmpeg::tools::get_error_description(res), res);
 				return false;
 			}
 		}
+
+		// Shared before anything is attached, side data only fits this encoder.
+		if (_frame_cache && !_scaled && !cached)
+			_frame_cache->insert(frame->data[0], share_frame(vframe.get()));
+		if (leader)
+			_ladder->publish(frame->data[0], share_frame(vframe.get()), scene_cut);
+
+		if (analysis) {
+			if (fused)
+				analysis->finish();
+			attach_analysis(vframe.get());
+		}
 	}
+	_unique_convert_time += std::chrono::high_resolution_clock::now() - begin;
 
-	if (!encode_avframe(vframe, packet, received_packet))
-		return false;
+	// Keep the converted frame around, the next duplicate can then be sent as is.
+	if (_duplicate_mode == duplicate_mode::REPEAT)
+		_last_frame = vframe;
 
-	return true;
+	bool res = dispatch_avframe(vframe, packet, received_packet);
+
+	govern(std::chrono::high_resolution_clock::now() - begin);
+	return res;
 }
 
 bool obsffmpeg::encoder::video_encode_texture(uint32_t handle, int64_t pts, uint64_t lock_key, uint64_t* next_lock_key,
@@ -1049,7 +2210,7 @@ bool obsffmpeg::encoder::video_encode_texture(uint32_t handle, int64_t pts, uint
 		return false;
 	}
 
-	std::shared_ptr<AVFrame> vframe = pop_free_frame();
+	std::shared_ptr<AVFrame> vframe = _hwinst->allocate_frame(_context->hw_frames_ctx);
 	_hwinst->copy_from_obs(_context->hw_frames_ctx, handle, lock_key, next_lock_key, vframe);
 
 	vframe->color_range     = _context->color_range;
@@ -1066,15 +2227,29 @@ bool obsffmpeg::encoder::video_encode_texture(uint32_t handle, int64_t pts, uint
 	return true;
 }
 
-int obsffmpeg::encoder::receive_packet(bool* received_packet, struct encoder_packet* packet)
+int obsffmpeg::encoder::receive_packets(size_t& packets)
 {
-	av_packet_unref(&_current_packet);
+	packets = 0;
+	while (true) {
+		AVPacket* pkt = _packet_pool.acquire_packet();
+		int       res = avcodec_receive_packet(_context, pkt);
+		if (res != 0) {
+			_packet_pool.release_packet(pkt);
+			return res;
+		}
 
-	int res = avcodec_receive_packet(_context, &_current_packet);
-	if (res != 0) {
-		return res;
+		process_packet(*pkt);
+		_pending_packets.push_back(pkt);
+		packets++;
+		release_frames(1);
+
+		if (_pending_packets.size() > _pending_packets_peak)
+			_pending_packets_peak = _pending_packets.size();
 	}
+}
 
+void obsffmpeg::encoder::process_packet(AVPacket& packet)
+{
 	if (!_have_first_frame) {
 		if (_codec->id == AV_CODEC_ID_H264) {
 			uint8_t* tmp_packet;
@@ -1082,8 +2257,8 @@ int obsffmpeg::encoder::receive_packet(bool* received_packet, struct encoder_pac
 			uint8_t* tmp_sei;
 			size_t   sz_packet, sz_header, sz_sei;
 
-			obs_extract_avc_headers(_current_packet.data, _current_packet.size, &tmp_packet, &sz_packet,
-			                        &tmp_header, &sz_header, &tmp_sei, &sz_sei);
+			obs_extract_avc_headers(packet.data, packet.size, &tmp_packet, &sz_packet, &tmp_header,
+			                        &sz_header, &tmp_sei, &sz_sei);
 
 			if (sz_header) {
 				_extra_data.resize(sz_header);
@@ -1096,15 +2271,16 @@ int obsffmpeg::encoder::receive_packet(bool* received_packet, struct encoder_pac
 			}
 
 			// Not required, we only need the Extra Data and SEI Data anyway.
-			//std::memcpy(_current_packet.data, tmp_packet, sz_packet);
-			//_current_packet.size = static_cast<int>(sz_packet);
+			//std::memcpy(packet.data, tmp_packet, sz_packet);
+			//packet.size = static_cast<int>(sz_packet);
 
 			bfree(tmp_packet);
 			bfree(tmp_header);
 			bfree(tmp_sei);
 		} else if (_codec->id == AV_CODEC_ID_HEVC) {
-			obsffmpeg::codecs::hevc::extract_header_sei(_current_packet.data, _current_packet.size,
-			                                            _extra_data, _sei_data);
+			obsffmpeg::codecs::hevc::extract_header_sei(packet.data, packet.size, _extra_data, _sei_data);
+		} else if (_parallel_extra_data) {
+			_extra_data = *_parallel_extra_data;
 		} else if (_context->extradata != nullptr) {
 			_extra_data.resize(_context->extradata_size);
 			std::memcpy(_extra_data.data(), _context->extradata, _context->extradata_size);
@@ -1114,30 +2290,25 @@ int obsffmpeg::encoder::receive_packet(bool* received_packet, struct encoder_pac
 
 	// Allow Handler Post-Processing
 	if (_handler)
-		_handler->process_avpacket(_current_packet, _codec, _context);
-
-	packet->type          = OBS_ENCODER_VIDEO;
-	packet->pts           = _current_packet.pts;
-	packet->dts           = _current_packet.dts;
-	packet->data          = _current_packet.data;
-	packet->size          = _current_packet.size;
-	packet->keyframe      = !!(_current_packet.flags & AV_PKT_FLAG_KEY);
-	packet->drop_priority = packet->keyframe ? 0 : 1;
-	*received_packet      = true;
-
-	push_free_frame(pop_used_frame());
+		_handler->process_avpacket(packet, _codec, _context);
+}
 
-	return res;
+void obsffmpeg::encoder::output_packet(AVPacket& packet, struct encoder_packet* packet_out, bool* received_packet)
+{
+	packet_out->type          = OBS_ENCODER_VIDEO;
+	packet_out->pts           = packet.pts;
+	packet_out->dts           = packet.dts;
+	packet_out->data          = packet.data;
+	packet_out->size          = packet.size;
+	packet_out->keyframe      = !!(packet.flags & AV_PKT_FLAG_KEY);
+	packet_out->drop_priority = packet_out->keyframe ? 0 : 1;
+	*received_packet          = true;
 }
 
 int obsffmpeg::encoder::send_frame(std::shared_ptr<AVFrame> const frame)
 {
-	int res = avcodec_send_frame(_context, frame.get());
-	if (res == 0) {
-		push_used_frame(frame);
-	}
-
-	return res;
+	// FFmpeg takes its own reference, the frame returns to the pool once it lets go of it.
+	return avcodec_send_frame(_context, frame.get());
 }
 
 bool obsffmpeg::encoder::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_packet* packet, bool* received_packet)
@@ -1146,16 +2317,15 @@ bool obsffmpeg::encoder::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_
 	ScopeProfiler profile("loop");
 #endif
 
-	bool sent_frame  = false;
-	bool recv_packet = false;
-	bool should_lag  = (_count_send_frames >= _lag_in_frames);
+	bool sent_frame = false;
+	bool should_lag = (_count_send_frames >= _lag_in_frames);
 
 	auto loop_begin = std::chrono::high_resolution_clock::now();
 	auto loop_end   = loop_begin + std::chrono::milliseconds(50);
 
-	while ((!sent_frame || (should_lag && !recv_packet))
+	while ((!sent_frame || (should_lag && _pending_packets.empty()))
 	       && !(std::chrono::high_resolution_clock::now() > loop_end)) {
-		bool eagain_is_stupid = false;
+		bool send_eagain = false;
 
 		if (!sent_frame) {
 #ifdef _DEBUG
@@ -1166,15 +2336,11 @@ bool obsffmpeg::encoder::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_
 			case 0:
 				sent_frame = true;
 				frame      = nullptr;
+				_frames_held++;
 				break;
 			case AVERROR(EAGAIN):
-				// This means we should call receive_packet again, but what do we do with that data?
-				// Why can't we queue on both? Do I really have to implement threading for this stuff?
-				if (*received_packet == true) {
-					PLOG_WARNING("Skipped frame due to EAGAIN when a packet was already returned.");
-					sent_frame = true;
-				}
-				eagain_is_stupid = true;
+				// The encoder is full, drain it below and then try again.
+				send_eagain = true;
 				break;
 			case AVERROR(EOF):
 				PLOG_ERROR("Skipped frame due to end of stream.");
@@ -1187,24 +2353,18 @@ bool obsffmpeg::encoder::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_
 			}
 		}
 
-		if (!recv_packet) {
+		{
 #ifdef _DEBUG
 			ScopeProfiler profile_inner("recieve");
 #endif
-			int res = receive_packet(received_packet, packet);
+			// Drain everything that is ready, packets we can't return right now are kept for later calls.
+			size_t packets = 0;
+			int    res     = receive_packets(packets);
 			switch (res) {
-			case 0:
-				recv_packet = true;
-				break;
 			case AVERROR(EOF):
-				PLOG_ERROR("Received end of file.");
-				recv_packet = true;
 				break;
 			case AVERROR(EAGAIN):
-				if (sent_frame) {
-					recv_packet = true;
-				}
-				if (eagain_is_stupid) {
+				if (send_eagain && (packets == 0)) {
 					PLOG_ERROR("Both send and recieve returned EAGAIN, encoder is broken.");
 					return false;
 				}
@@ -1214,15 +2374,176 @@ bool obsffmpeg::encoder::encode_avframe(std::shared_ptr<AVFrame> frame, encoder_
 				           ffmpeg::tools::get_error_description(res), res);
 				return false;
 			}
+
+			// Room was made, so resend immediately.
+			if (send_eagain)
+				continue;
 		}
 
-		if (!sent_frame || !recv_packet) {
+		if (!sent_frame || (should_lag && _pending_packets.empty())) {
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
 	}
 
-	if (!sent_frame)
-		push_free_frame(frame);
+	if (!sent_frame) {
+		PLOG_WARNING("Skipped frame as the encoder did not accept it in time.");
+	}
+
+	// OBS has consumed the previously returned packet by now, so hand out the oldest pending one.
+	if (!_pending_packets.empty()) {
+		AVPacket* pkt = _pending_packets.front();
+		_pending_packets.pop_front();
+
+		av_packet_unref(&_current_packet);
+		av_packet_move_ref(&_current_packet, pkt);
+		_packet_pool.release_packet(pkt);
+		output_packet(_current_packet, packet, received_packet);
+	}
 
 	return true;
 }
+
+bool obsffmpeg::encoder::queue_avframe(std::shared_ptr<AVFrame> frame, encoder_packet* packet, bool* received_packet)
+{
+	if (_worker_failed)
+		return false;
+
+	// OBS has consumed the previously returned packet by now.
+	av_packet_unref(&_current_packet);
+
+	// Hand the frame off to the worker, waiting only if it is a full queue behind.
+	if (!_worker_frames->push(frame)) {
+		std::unique_lock<std::mutex> ulock(_worker_lock);
+		_encode_cv.wait(ulock, [this]() { return _worker_failed || !_worker_frames->full(); });
+		if (_worker_failed)
+			return false;
+		_worker_frames->push(frame);
+	}
+	_frames_held++;
+	{
+		std::unique_lock<std::mutex> ulock(_worker_lock);
+	}
+	_worker_cv.notify_all();
+
+	// Return whatever the worker has already finished.
+	AVPacket* pkt = nullptr;
+	if (_worker_packets->pop(pkt)) {
+		av_packet_move_ref(&_current_packet, pkt);
+		_packet_pool.release_packet(pkt);
+		output_packet(_current_packet, packet, received_packet);
+	}
+
+	return true;
+}
+
+bool obsffmpeg::encoder::parallel_avframe(std::shared_ptr<AVFrame> frame, encoder_packet* packet,
+                                          bool* received_packet)
+{
+	// Waits for the oldest lane if all of them are busy, so packets come back with a latency of one segment per
+	// lane, which is a frame or a GOP.
+	if (frame) {
+		if (!_parallel.push(frame))
+			return false;
+		_frames_held++;
+	}
+	if (_parallel.has_failed())
+		return false;
+
+	AVPacket* pkt = nullptr;
+	while (_parallel.pop(pkt)) {
+		// Each GOP's decode timestamps continue where the previous one ended if all lanes delay frames equally.
+		if ((_parallel_dts != AV_NOPTS_VALUE) && (pkt->dts <= _parallel_dts)) {
+			PLOG_WARNING("[%s] Decode timestamp %" PRId64 " after %" PRId64 " from parallel encoding.",
+			             _codec->name, pkt->dts, _parallel_dts);
+		}
+		_parallel_dts = pkt->dts;
+		process_packet(*pkt);
+		_pending_packets.push_back(pkt);
+		release_frames(1);
+
+		if (_pending_packets.size() > _pending_packets_peak)
+			_pending_packets_peak = _pending_packets.size();
+	}
+
+	// OBS has consumed the previously returned packet by now, so hand out the oldest pending one.
+	if (!_pending_packets.empty()) {
+		AVPacket* next = _pending_packets.front();
+		_pending_packets.pop_front();
+
+		av_packet_unref(&_current_packet);
+		av_packet_move_ref(&_current_packet, next);
+		_packet_pool.release_packet(next);
+		output_packet(_current_packet, packet, received_packet);
+	}
+
+	return true;
+}
+
+bool obsffmpeg::encoder::dispatch_avframe(std::shared_ptr<AVFrame> frame, encoder_packet* packet,
+                                          bool* received_packet)
+{
+	if (_parallel.is_valid())
+		return parallel_avframe(frame, packet, received_packet);
+	if (_worker_enabled)
+		return queue_avframe(frame, packet, received_packet);
+	return encode_avframe(frame, packet, received_packet);
+}
+
+bool obsffmpeg::encoder::skip_avframe(encoder_packet* packet, bool* received_packet)
+{
+	// Nothing is sent, but OBS still expects packets which are ready to be handed out.
+	if (_parallel.is_valid())
+		return parallel_avframe(nullptr, packet, received_packet);
+
+	if (_worker_enabled) {
+		if (_worker_failed)
+			return false;
+
+		av_packet_unref(&_current_packet);
+
+		AVPacket* pkt = nullptr;
+		if (_worker_packets->pop(pkt)) {
+			av_packet_move_ref(&_current_packet, pkt);
+			_packet_pool.release_packet(pkt);
+			output_packet(_current_packet, packet, received_packet);
+		}
+		return true;
+	}
+
+	size_t packets = 0;
+	int    res     = receive_packets(packets);
+	if ((res != AVERROR(EAGAIN)) && (res != AVERROR(EOF))) {
+		PLOG_ERROR("Failed to receive packet: %s (%ld).", ffmpeg::tools::get_error_description(res), res);
+		return false;
+	}
+
+	if (!_pending_packets.empty()) {
+		AVPacket* pkt = _pending_packets.front();
+		_pending_packets.pop_front();
+
+		av_packet_unref(&_current_packet);
+		av_packet_move_ref(&_current_packet, pkt);
+		_packet_pool.release_packet(pkt);
+		output_packet(_current_packet, packet, received_packet);
+	}
+
+	return true;
+}
+
+obsffmpeg::duplicate_statistics obsffmpeg::encoder::get_duplicate_statistics()
+{
+	duplicate_statistics stats;
+	stats.unique   = _unique_frames;
+	stats.skipped  = _duplicates_skipped;
+	stats.repeated = _duplicates_repeated;
+	stats.saved_ms = 0;
+
+	// Skipped frames save the whole frame, repeated ones only the conversion.
+	if (_unique_frames > 0) {
+		double_t total   = std::chrono::duration<double_t, std::milli>(_unique_total_time).count();
+		double_t convert = std::chrono::duration<double_t, std::milli>(_unique_convert_time).count();
+		stats.saved_ms   = (total * _duplicates_skipped + convert * _duplicates_repeated) / _unique_frames;
+	}
+
+	return stats;
+}
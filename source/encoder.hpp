@@ -21,15 +21,30 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
-#include <stack>
 #include <thread>
 #include <vector>
-#include "ffmpeg/avframe-queue.hpp"
+#include "convert/converter.hpp"
+#include "convert/frame-analysis.hpp"
+#include "convert/plane-copy.hpp"
+#include "convert/roi-map.hpp"
+#include "convert/scene-detect.hpp"
+#include "ffmpeg/avframe-pool.hpp"
+#include "ffmpeg/avpacket-pool.hpp"
 #include "ffmpeg/swscale.hpp"
+#include "frame-cache.hpp"
+#include "governor.hpp"
 #include "hwapi/base.hpp"
+#include "ladder.hpp"
+#include "parallel-encoder.hpp"
+#include "ring-buffer.hpp"
+#include "threadpool.hpp"
 #include "ui/handler.hpp"
 
 extern "C" {
@@ -55,6 +70,32 @@ namespace obsffmpeg {
 		obs_encoder_info oei = {0};
 	};
 
+	enum class duplicate_mode : int64_t {
+		DISABLED = 0,
+		// Don't encode duplicates at all, only for outputs that handle variable frame rate.
+		SKIP = 1,
+		// Send the previous frame again without converting, the encoder codes it as an unchanged frame.
+		REPEAT = 2,
+	};
+
+	enum class backpressure_mode : int64_t {
+		DISABLED = 0,
+		// Drop new frames while too many are in flight.
+		DROP = 1,
+		// Only encode every other frame while too many are in flight, dropping them only at the hard limit.
+		DECIMATE = 2,
+		// Wait for the encoder to release frames, and drop only if that takes too long.
+		BLOCK = 3,
+	};
+
+	struct duplicate_statistics {
+		uint64_t unique;
+		uint64_t skipped;
+		uint64_t repeated;
+		// Estimated from the average cost of unique frames.
+		double_t saved_ms;
+	};
+
 	class encoder_factory {
 		encoder_info   info;
 		encoder_info   info_fallback;
@@ -91,8 +132,17 @@ namespace obsffmpeg {
 		std::shared_ptr<obsffmpeg::hwapi::base>     _hwapi;
 		std::shared_ptr<obsffmpeg::hwapi::instance> _hwinst;
 
-		ffmpeg::swscale _swscale;
-		AVPacket        _current_packet;
+		ffmpeg::swscale       _swscale;
+		ffmpeg::avpacket_pool _packet_pool;
+		AVPacket              _current_packet;
+
+		// Conversion
+		std::shared_ptr<obsffmpeg::threadpool> _threadpool;
+		convert::plane_copy                    _plane_copy;
+		convert::converter                     _converter;
+		convert::frame_analysis                _analysis;
+		convert::roi_map                       _roi;
+		convert::scene_detect                  _scene;
 
 		size_t _lag_in_frames;
 		size_t _count_send_frames;
@@ -102,19 +152,112 @@ namespace obsffmpeg {
 		std::vector<uint8_t> _extra_data;
 		std::vector<uint8_t> _sei_data;
 
-		// Frame Stack and Queue
-		std::stack<std::shared_ptr<AVFrame>>           _free_frames;
-		std::queue<std::shared_ptr<AVFrame>>           _used_frames;
-		std::chrono::high_resolution_clock::time_point _free_frames_last_used;
+		// Pending Packets
+		std::deque<AVPacket*> _pending_packets;
+		size_t                _pending_packets_peak;
+
+		// Frame Pool
+		ffmpeg::avframe_pool _frame_pool;
+		bool                 _zero_copy;
+		size_t               _zero_copy_probe; // Frames left to copy before passing them as-is.
+
+		// Duplicate Frames
+		duplicate_mode           _duplicate_mode;
+		size_t                   _duplicate_keepalive;
+		size_t                   _duplicate_run;
+		std::shared_ptr<AVFrame> _last_frame;
+		uint64_t                 _duplicates_skipped;
+		uint64_t                 _duplicates_repeated;
+		uint64_t                 _unique_frames;
+		std::chrono::nanoseconds _unique_convert_time;
+		std::chrono::nanoseconds _unique_total_time;
+
+		// Backpressure
+		backpressure_mode        _backpressure;
+		size_t                   _backpressure_frames;
+		size_t                   _backpressure_bytes;
+		std::atomic<size_t>      _frames_held; // Sent to the queue, a lane or the codec, without a packet yet.
+		bool                     _overloaded;
+		bool                     _decimate_skip;
+		bool                     _decimated;
+		uint64_t                 _backpressure_dropped;
+		uint64_t                 _backpressure_decimated;
+		uint64_t                 _backpressure_blocked;
+		std::chrono::nanoseconds _backpressure_block_time;
+
+		// Resolution and Preset Governor
+		resolution_governor _governor;
+		bool                _scaled;
+		preset_governor     _presets;
+		size_t              _gop_position;
+		size_t              _keyframe_interval; // Frames between the keyframes placed here, 0 if none are.
+		bool                _preset_pending;
+		std::string         _preset_options; // Level the running encoder has applied.
+
+		// Shared Conversion
+		std::shared_ptr<frame_cache> _frame_cache;
+		uint64_t                     _frame_cache_hits;
+		uint64_t                     _frame_cache_misses;
+
+		// Ladder
+		std::shared_ptr<ladder> _ladder;
+		uint64_t                _ladder_hits;
+		uint64_t                _ladder_misses;
+
+		// Parallel Encoding
+		parallel_encoder _parallel;
+		int64_t          _parallel_dts;
+
+		// Extra data of the first lane, every later lane has to match it. Set before the lanes start.
+		std::shared_ptr<const std::vector<uint8_t>> _parallel_extra_data;
+
+		// Worker Thread
+		bool                                                 _worker_enabled;
+		std::thread                                          _worker;
+		std::atomic<bool>                                    _worker_stop;
+		std::atomic<bool>                                    _worker_failed;
+		std::mutex                                           _worker_lock;
+		std::condition_variable                              _worker_cv;
+		std::condition_variable                              _encode_cv;
+		std::unique_ptr<spsc_ring<std::shared_ptr<AVFrame>>> _worker_frames;
+		std::unique_ptr<spsc_ring<AVPacket*>>                _worker_packets;
+		std::deque<AVPacket*>                                _worker_overflow;
 
 		void initialize_sw(obs_data_t* settings);
 		void initialize_hw(obs_data_t* settings);
 
-		void                     push_free_frame(std::shared_ptr<AVFrame> frame);
-		std::shared_ptr<AVFrame> pop_free_frame();
+		void start_worker();
+		void stop_worker();
+		void worker_main();
+		bool worker_drain(size_t& packets);
+		void worker_flush_overflow();
+
+		// Attaches the last frame analysis, and the regions of interest derived from it.
+		void attach_analysis(AVFrame* frame);
+
+		// Decides if the next frame may be encoded, or has to be dropped to keep frames in flight bounded.
+		bool admit_frame();
+		void release_frames(size_t count);
+
+		// Counts a frame that was converted and encoded, and lets the governor react to how long it took.
+		void govern(std::chrono::nanoseconds time);
+
+		// Counts a frame that went to the encoder, converted or repeated, towards the current GOP.
+		void advance_gop();
 
-		void                     push_used_frame(std::shared_ptr<AVFrame> frame);
-		std::shared_ptr<AVFrame> pop_used_frame();
+		// Leaves the keyframes to the ones the leader of the ladder forces, returns false if the encoder may
+		// still place its own on scene cuts.
+		bool defer_keyframes();
+
+		// Replaces the encoder with one of the given resolution, and the current preset level.
+		void reconfigure(uint32_t width, uint32_t height);
+
+		// Applies options to the open encoder, returns false if any of them can't be changed at runtime.
+		bool apply_runtime_options(const std::string& options);
+
+		// Creates an opened encoder with the same settings as the main one, for one of the parallel lanes.
+		// Closed GOPs keep frame threads, since their lanes are drained at the end of each GOP.
+		AVCodecContext* clone_context(int threads, bool closed_gops);
 
 		public:
 		encoder(obs_data_t* settings, obs_encoder_t* encoder, bool is_texture_encode = false);
@@ -145,11 +288,29 @@ namespace obsffmpeg {
 		bool video_encode_texture(uint32_t handle, int64_t pts, uint64_t lock_key, uint64_t* next_key,
 		                          struct encoder_packet* packet, bool* received_packet);
 
-		int receive_packet(bool* received_packet, struct encoder_packet* packet);
+		int receive_packets(size_t& packets);
+
+		void process_packet(AVPacket& packet);
+
+		void output_packet(AVPacket& packet, struct encoder_packet* packet_out, bool* received_packet);
 
 		int send_frame(std::shared_ptr<AVFrame> frame);
 
 		bool encode_avframe(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
 		                    bool* received_packet);
+
+		bool queue_avframe(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
+		                   bool* received_packet);
+
+		bool parallel_avframe(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
+		                      bool* received_packet);
+
+		// Hands the frame to the parallel encoder, the worker thread, or encodes it right away.
+		bool dispatch_avframe(std::shared_ptr<AVFrame> frame, struct encoder_packet* packet,
+		                      bool* received_packet);
+
+		bool skip_avframe(struct encoder_packet* packet, bool* received_packet);
+
+		duplicate_statistics get_duplicate_statistics();
 	};
 } // namespace obsffmpeg
@@ -0,0 +1,460 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "avframe-pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <tuple>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#pragma warning(pop)
+}
+
+// Bytes reserved in front of every buffer for bookkeeping, also keeps the image data aligned.
+static constexpr size_t header_size = 64;
+// Extra bytes behind the image data, SIMD code may read slightly past the last line.
+static constexpr size_t padding_size = 64;
+// Number of get() calls after which the pool is checked against the high water mark.
+static constexpr uint64_t trim_window = 300;
+// Most buffers kept for a key, enough for the lookahead of most encoders. Buffers in use are never freed.
+static constexpr size_t buffer_limit = 64;
+// Memory idle buffers may take up across all keys. Once over, the least recently used keys give up their buffers
+// first.
+static constexpr size_t idle_budget = 512ull << 20;
+
+struct ffmpeg::avframe_pool::shared_state {
+	// One reference for the owning pool, one for every frame handed out.
+	std::atomic<size_t> references;
+
+	std::atomic<uint64_t> requests;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> trims;
+	std::atomic<size_t>   in_use;
+	std::atomic<size_t>   bytes_in_use;
+
+	shared_state() : references(1), requests(0), misses(0), trims(0), in_use(0), bytes_in_use(0) {}
+};
+
+// Buffers of one key, shared by every pool in the process. Only used with the registry lock held.
+struct ffmpeg::avframe_pool::bucket {
+	avframe_pool_key key;
+	size_t           buffer_size;
+
+	// Most recently released at the back, where get() takes from while they are still warm.
+	std::deque<uint8_t*> idle;
+	size_t               held;
+	size_t               in_use;
+
+	// Pools using this key, and the sum of their high water marks.
+	size_t users;
+	size_t demand;
+
+	uint64_t                              window_gets;
+	size_t                                window_peak;
+	std::chrono::steady_clock::time_point last_used;
+
+	~bucket()
+	{
+		for (auto data : idle) {
+			free_buffer(data);
+		}
+	}
+};
+
+struct buffer_header {
+	size_t size;
+	void*  owner;
+};
+static_assert(sizeof(buffer_header) <= header_size, "Buffer header does not fit.");
+
+static std::mutex registry_lock;
+
+std::map<ffmpeg::avframe_pool_key, std::unique_ptr<ffmpeg::avframe_pool::bucket>> ffmpeg::avframe_pool::buckets;
+
+static inline buffer_header* get_header(uint8_t* data)
+{
+	return reinterpret_cast<buffer_header*>(data - header_size);
+}
+
+bool ffmpeg::avframe_pool_key::operator<(const avframe_pool_key& other) const
+{
+	return std::tie(format, width, height, align) < std::tie(other.format, other.width, other.height, other.align);
+}
+
+uint8_t* ffmpeg::avframe_pool::allocate_buffer(bucket* owner)
+{
+	uint8_t* mem = reinterpret_cast<uint8_t*>(av_malloc(owner->buffer_size + header_size));
+	if (!mem)
+		throw std::runtime_error("Failed to allocate frame buffer.");
+
+	auto header   = reinterpret_cast<buffer_header*>(mem);
+	header->size  = owner->buffer_size;
+	header->owner = owner;
+
+	owner->held++;
+	return mem + header_size;
+}
+
+void ffmpeg::avframe_pool::free_buffer(uint8_t* data)
+{
+	auto header = get_header(data);
+	static_cast<bucket*>(header->owner)->held--;
+	av_free(header);
+}
+
+size_t ffmpeg::avframe_pool::shrink(bucket* owner, size_t count)
+{
+	// Oldest first, the most recently used ones are the most likely to still be cached.
+	size_t freed = 0;
+	while ((owner->held > count) && !owner->idle.empty()) {
+		free_buffer(owner->idle.front());
+		owner->idle.pop_front();
+		freed++;
+	}
+	return freed;
+}
+
+size_t ffmpeg::avframe_pool::get_retained(bucket* owner)
+{
+	// What the pools of the key and its recent peak need, which keeps a key nobody uses warm for a restarted
+	// encoder, up to the limit.
+	return std::max(owner->in_use, std::min(buffer_limit, std::max(owner->demand, owner->window_peak)));
+}
+
+void ffmpeg::avframe_pool::enforce_budget()
+{
+	size_t idle_bytes = 0;
+	for (auto& kv : buckets) {
+		idle_bytes += kv.second->idle.size() * kv.second->buffer_size;
+	}
+
+	// Take from the key that went unused the longest, one buffer at a time.
+	while (idle_bytes > idle_budget) {
+		bucket* oldest = nullptr;
+		for (auto& kv : buckets) {
+			if (!kv.second->idle.empty() && (!oldest || (kv.second->last_used < oldest->last_used)))
+				oldest = kv.second.get();
+		}
+		if (!oldest)
+			break;
+
+		idle_bytes -= oldest->buffer_size;
+		free_buffer(oldest->idle.front());
+		oldest->idle.pop_front();
+	}
+
+	// Keys nobody uses and that hold nothing anymore.
+	for (auto it = buckets.begin(); it != buckets.end();) {
+		if ((it->second->users == 0) && (it->second->held == 0)) {
+			it = buckets.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void ffmpeg::avframe_pool::release_buffer(void* opaque, uint8_t* data)
+{
+	auto   state = reinterpret_cast<shared_state*>(opaque);
+	size_t size  = get_header(data)->size;
+
+	// FFmpeg and everyone else are done with the frame, keep the memory for the next one unless there's too much.
+	{
+		std::unique_lock<std::mutex> rlock(registry_lock);
+		bucket*                      owner = static_cast<bucket*>(get_header(data)->owner);
+		owner->in_use--;
+		if (owner->held > get_retained(owner)) {
+			free_buffer(data);
+			state->trims++;
+		} else {
+			owner->idle.push_back(data);
+		}
+		enforce_budget();
+	}
+
+	state->in_use--;
+	state->bytes_in_use -= size;
+	release_state(state);
+}
+
+void ffmpeg::avframe_pool::release_state(shared_state* state)
+{
+	if (--state->references == 0)
+		delete state;
+}
+
+ffmpeg::avframe_pool::avframe_pool() : state(new shared_state()) {}
+
+ffmpeg::avframe_pool::~avframe_pool()
+{
+	{
+		std::unique_lock<std::mutex> ulock(this->lock);
+		retire();
+	}
+	release_state(this->state);
+}
+
+void ffmpeg::avframe_pool::set_resolution(uint32_t const width, uint32_t const height)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	if ((this->resolution.first != width) || (this->resolution.second != height))
+		retire();
+	this->resolution.first  = width;
+	this->resolution.second = height;
+}
+
+void ffmpeg::avframe_pool::get_resolution(uint32_t& width, uint32_t& height)
+{
+	width  = this->resolution.first;
+	height = this->resolution.second;
+}
+
+uint32_t ffmpeg::avframe_pool::get_width()
+{
+	return this->resolution.first;
+}
+
+uint32_t ffmpeg::avframe_pool::get_height()
+{
+	return this->resolution.second;
+}
+
+void ffmpeg::avframe_pool::set_pixel_format(AVPixelFormat const format)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	if (this->format != format)
+		retire();
+	this->format = format;
+}
+
+AVPixelFormat ffmpeg::avframe_pool::get_pixel_format()
+{
+	return this->format;
+}
+
+void ffmpeg::avframe_pool::set_alignment(int const align)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	if (this->align != align)
+		retire();
+	this->align = align;
+}
+
+int ffmpeg::avframe_pool::get_alignment()
+{
+	return this->align;
+}
+
+void ffmpeg::avframe_pool::set_high_water(size_t const count)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	if (this->current) {
+		std::unique_lock<std::mutex> rlock(registry_lock);
+		this->current->demand = this->current->demand - this->high_water + count;
+	}
+	this->high_water = count;
+}
+
+size_t ffmpeg::avframe_pool::get_high_water()
+{
+	return this->high_water;
+}
+
+ffmpeg::avframe_pool::bucket* ffmpeg::avframe_pool::attach()
+{
+	if (this->current)
+		return this->current;
+
+	avframe_pool_key key = {this->format, this->resolution.first, this->resolution.second, this->align};
+
+	std::unique_lock<std::mutex> rlock(registry_lock);
+	std::unique_ptr<bucket>&     owner = buckets[key];
+	if (!owner) {
+		int size = av_image_get_buffer_size(this->format, static_cast<int>(this->resolution.first),
+		                                    static_cast<int>(this->resolution.second), this->align);
+		if (size < 0) {
+			buckets.erase(key);
+			throw std::runtime_error("Invalid resolution or pixel format for frame pool.");
+		}
+
+		owner              = std::make_unique<bucket>();
+		owner->key         = key;
+		owner->buffer_size = static_cast<size_t>(size) + padding_size;
+		owner->held        = 0;
+		owner->in_use      = 0;
+		owner->users       = 0;
+		owner->demand      = 0;
+		owner->window_gets = 0;
+		owner->window_peak = 0;
+	}
+	owner->users++;
+	owner->demand += this->high_water;
+	owner->last_used = std::chrono::steady_clock::now();
+
+	this->current = owner.get();
+	return this->current;
+}
+
+void ffmpeg::avframe_pool::retire()
+{
+	// The buffers stay with the key for whoever uses it next, down to what is kept for unused keys.
+	if (!this->current)
+		return;
+
+	std::unique_lock<std::mutex> rlock(registry_lock);
+	this->current->users--;
+	this->current->demand -= this->high_water;
+	shrink(this->current, get_retained(this->current));
+	this->current = nullptr;
+	enforce_budget();
+}
+
+void ffmpeg::avframe_pool::prewarm(size_t const count)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	bucket*                      owner = attach();
+
+	std::unique_lock<std::mutex> rlock(registry_lock);
+	while (owner->idle.size() < count) {
+		owner->idle.push_back(allocate_buffer(owner));
+		this->state->requests++;
+		this->state->misses++;
+	}
+	owner->last_used = std::chrono::steady_clock::now();
+	enforce_budget();
+}
+
+void ffmpeg::avframe_pool::trim()
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	if (this->current) {
+		std::unique_lock<std::mutex> rlock(registry_lock);
+		shrink(this->current, 0);
+		enforce_budget();
+	}
+	this->state->trims++;
+}
+
+std::shared_ptr<AVFrame> ffmpeg::avframe_pool::get()
+{
+	std::shared_ptr<AVFrame> frame = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* frame) {
+		av_frame_unref(frame);
+		av_frame_free(&frame);
+	});
+	if (!frame)
+		throw std::runtime_error("Failed to allocate frame.");
+
+	std::unique_lock<std::mutex> ulock(this->lock);
+	bucket*                      owner = attach();
+
+	uint8_t* data;
+	{
+		std::unique_lock<std::mutex> rlock(registry_lock);
+
+		// Trim once the key holds more than was recently needed and more than all of its pools asked for.
+		owner->window_gets++;
+		owner->window_peak = std::max(owner->window_peak, owner->in_use + 1);
+		if (owner->window_gets >= trim_window) {
+			if (shrink(owner, get_retained(owner)) > 0)
+				this->state->trims++;
+			owner->window_gets = 0;
+			owner->window_peak = owner->in_use + 1;
+		}
+
+		this->state->requests++;
+		if (!owner->idle.empty()) {
+			data = owner->idle.back();
+			owner->idle.pop_back();
+		} else {
+			data = allocate_buffer(owner);
+			this->state->misses++;
+		}
+		owner->in_use++;
+		owner->last_used = std::chrono::steady_clock::now();
+	}
+
+	// Wrap the buffer so that we know when the last reference to it is gone.
+	size_t size = get_header(data)->size;
+	this->state->references++;
+	this->state->in_use++;
+	this->state->bytes_in_use += size;
+	frame->buf[0] = av_buffer_create(data, static_cast<int>(size), &avframe_pool::release_buffer, this->state, 0);
+	if (!frame->buf[0]) {
+		release_buffer(this->state, data);
+		throw std::runtime_error("Failed to allocate frame buffer.");
+	}
+
+	frame->width         = static_cast<int>(this->resolution.first);
+	frame->height        = static_cast<int>(this->resolution.second);
+	frame->format        = this->format;
+	frame->extended_data = frame->data;
+	av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, this->format, frame->width,
+	                     frame->height, this->align);
+
+	return frame;
+}
+
+ffmpeg::avframe_pool_statistics ffmpeg::avframe_pool::get_statistics()
+{
+	avframe_pool_statistics stats;
+	stats.misses       = this->state->misses;
+	stats.hits         = this->state->requests - stats.misses;
+	stats.trims        = this->state->trims;
+	stats.in_use       = this->state->in_use;
+	stats.bytes_in_use = this->state->bytes_in_use;
+
+	std::unique_lock<std::mutex> ulock(this->lock);
+	std::unique_lock<std::mutex> rlock(registry_lock);
+	stats.held       = this->current ? this->current->held : 0;
+	stats.bytes_held = this->current ? (this->current->held * this->current->buffer_size) : 0;
+	return stats;
+}
+
+ffmpeg::avframe_pool_usage ffmpeg::avframe_pool::get_key_usage()
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	std::unique_lock<std::mutex> rlock(registry_lock);
+	avframe_pool_usage           entry = {};
+	if (this->current)
+		entry = get_usage(this->current);
+	return entry;
+}
+
+ffmpeg::avframe_pool_usage ffmpeg::avframe_pool::get_usage(bucket* owner)
+{
+	avframe_pool_usage entry;
+	entry.key          = owner->key;
+	entry.users        = owner->users;
+	entry.held         = owner->held;
+	entry.in_use       = owner->in_use;
+	entry.bytes_held   = owner->held * owner->buffer_size;
+	entry.bytes_in_use = owner->in_use * owner->buffer_size;
+	entry.limit        = get_retained(owner);
+	return entry;
+}
@@ -0,0 +1,137 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#pragma warning(pop)
+}
+
+namespace ffmpeg {
+	// Frames with the same key can use each others buffers.
+	struct avframe_pool_key {
+		AVPixelFormat format;
+		uint32_t      width;
+		uint32_t      height;
+		int           align;
+
+		bool operator<(const avframe_pool_key& other) const;
+	};
+
+	struct avframe_pool_usage {
+		avframe_pool_key key;
+		size_t           users;
+		size_t           held;
+		size_t           in_use;
+		size_t           bytes_held;
+		size_t           bytes_in_use;
+		size_t           limit;
+	};
+
+	struct avframe_pool_statistics {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t trims;
+		size_t   in_use;
+		size_t   held;
+		size_t   bytes_held;
+		size_t   bytes_in_use;
+	};
+
+	// Pool of video frames, backed by buffers shared with every other pool in the process.
+	// Frames handed out by get() return their memory to the pool as soon as the last reference to them is dropped,
+	// no matter if that reference was held by us or by FFmpeg. Buffers are kept per pixel format, resolution and
+	// alignment, so a pool that changes either of them or is created anew finds the buffers others left behind.
+	// The pool is safe to use from multiple threads.
+	class avframe_pool {
+		struct shared_state;
+		struct bucket;
+
+		shared_state* state;
+		std::mutex    lock;
+
+		std::pair<uint32_t, uint32_t> resolution;
+		AVPixelFormat                 format = AV_PIX_FMT_NONE;
+		int                           align  = 32;
+
+		bucket* current    = nullptr;
+		size_t  high_water = 0;
+
+		static std::map<avframe_pool_key, std::unique_ptr<bucket>> buckets;
+
+		bucket* attach();
+
+		void retire();
+
+		static uint8_t*           allocate_buffer(bucket* owner);
+		static void               free_buffer(uint8_t* data);
+		static size_t             shrink(bucket* owner, size_t count);
+		static size_t             get_retained(bucket* owner);
+		static avframe_pool_usage get_usage(bucket* owner);
+		static void               enforce_budget();
+		static void               release_buffer(void* opaque, uint8_t* data);
+		static void               release_state(shared_state* state);
+
+		public:
+		avframe_pool();
+		~avframe_pool();
+
+		void     set_resolution(uint32_t width, uint32_t height);
+		void     get_resolution(uint32_t& width, uint32_t& height);
+		uint32_t get_width();
+		uint32_t get_height();
+
+		void          set_pixel_format(AVPixelFormat format);
+		AVPixelFormat get_pixel_format();
+
+		void set_alignment(int align);
+		int  get_alignment();
+
+		// Number of buffers the pool needs without being trimmed, in addition to the recently observed peak.
+		// Other pools of the same key add their own, up to the limit of the key.
+		void   set_high_water(size_t count);
+		size_t get_high_water();
+
+		// Allocate buffers ahead of time so the first frames do not have to.
+		void prewarm(size_t count);
+
+		// Release all buffers of this key that are not currently in use.
+		void trim();
+
+		std::shared_ptr<AVFrame> get();
+
+		// Buffers held and in use are counted for the key, and shared with other pools using the same one.
+		avframe_pool_statistics get_statistics();
+
+		// Usage of the key the pool currently uses, shared with every other pool of it.
+		avframe_pool_usage get_key_usage();
+	};
+} // namespace ffmpeg
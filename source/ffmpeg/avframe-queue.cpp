@@ -20,27 +20,15 @@
 // SOFTWARE.
 
 #include "avframe-queue.hpp"
-#include "tools.hpp"
 
 std::shared_ptr<AVFrame> ffmpeg::avframe_queue::create_frame()
 {
-	std::shared_ptr<AVFrame> frame = std::shared_ptr<AVFrame>(av_frame_alloc(), [](AVFrame* frame) {
-		av_frame_unref(frame);
-		av_frame_free(&frame);
-	});
-	frame->width                   = this->resolution.first;
-	frame->height                  = this->resolution.second;
-	frame->format                  = this->format;
-
-	int res = av_frame_get_buffer(frame.get(), 32);
-	if (res < 0) {
-		throw std::exception(ffmpeg::tools::get_error_description(res));
-	}
-
-	return frame;
+	return this->pool.get();
 }
 
-ffmpeg::avframe_queue::avframe_queue() {}
+ffmpeg::avframe_queue::avframe_queue(size_t capacity)
+    : frames(capacity), frame_width(0), frame_height(0), frame_format(AV_PIX_FMT_NONE)
+{}
 
 ffmpeg::avframe_queue::~avframe_queue()
 {
@@ -49,73 +37,75 @@ ffmpeg::avframe_queue::~avframe_queue()
 
 void ffmpeg::avframe_queue::set_resolution(uint32_t const width, uint32_t const height)
 {
-	this->resolution.first  = width;
-	this->resolution.second = height;
+	this->frame_width  = width;
+	this->frame_height = height;
+	this->pool.set_resolution(width, height);
 }
 
 void ffmpeg::avframe_queue::get_resolution(uint32_t& width, uint32_t& height)
 {
-	width  = this->resolution.first;
-	height = this->resolution.second;
+	width  = this->frame_width;
+	height = this->frame_height;
 }
 
 uint32_t ffmpeg::avframe_queue::get_width()
 {
-	return this->resolution.first;
+	return this->frame_width;
 }
 
 uint32_t ffmpeg::avframe_queue::get_height()
 {
-	return this->resolution.second;
+	return this->frame_height;
 }
 
 void ffmpeg::avframe_queue::set_pixel_format(AVPixelFormat const format)
 {
-	this->format = format;
+	this->frame_format = format;
+	this->pool.set_pixel_format(format);
 }
 
 AVPixelFormat ffmpeg::avframe_queue::get_pixel_format()
 {
-	return this->format;
+	return this->frame_format;
+}
+
+ffmpeg::avframe_pool& ffmpeg::avframe_queue::get_pool()
+{
+	return this->pool;
 }
 
 void ffmpeg::avframe_queue::precache(size_t count)
 {
 	for (size_t n = 0; n < count; n++) {
-		push(create_frame());
+		if (!push(create_frame()))
+			break;
 	}
 }
 
 void ffmpeg::avframe_queue::clear()
 {
-	std::unique_lock<std::mutex> ulock(this->lock);
-	frames.clear();
+	std::shared_ptr<AVFrame> frame;
+	while (this->frames.pop(frame)) {
+	}
 }
 
-void ffmpeg::avframe_queue::push(std::shared_ptr<AVFrame> const frame)
+bool ffmpeg::avframe_queue::push(std::shared_ptr<AVFrame> frame)
 {
-	std::unique_lock<std::mutex> ulock(this->lock);
-	frames.push_back(frame);
+	return this->frames.push(frame);
 }
 
 std::shared_ptr<AVFrame> ffmpeg::avframe_queue::pop()
 {
-	std::unique_lock<std::mutex> ulock(this->lock);
-	std::shared_ptr<AVFrame>     ret;
+	std::shared_ptr<AVFrame> ret;
 	while (ret == nullptr) {
-		if (frames.size() == 0) {
+		if (!this->frames.pop(ret)) {
 			ret = create_frame();
-		} else {
-			ret = frames.front();
-			if (ret == nullptr) {
-				ret = create_frame();
-			} else {
-				frames.pop_front();
-				if ((static_cast<uint32_t>(ret->width) != this->resolution.first)
-				    || (static_cast<uint32_t>(ret->height) != this->resolution.second)
-				    || (ret->format != this->format)) {
-					ret = nullptr;
-				}
+		} else if (ret != nullptr) {
+			// Frames queued before a resolution or format change are of no use anymore.
+			if ((static_cast<uint32_t>(ret->width) != this->frame_width)
+			    || (static_cast<uint32_t>(ret->height) != this->frame_height)
+			    || (ret->format != this->frame_format)) {
+				ret = nullptr;
 			}
 		}
 	}
@@ -124,24 +114,17 @@ std::shared_ptr<AVFrame> ffmpeg::avframe_queue::pop()
 
 std::shared_ptr<AVFrame> ffmpeg::avframe_queue::pop_only()
 {
-	std::unique_lock<std::mutex> ulock(this->lock);
-	if (frames.size() == 0) {
-		return nullptr;
-	}
-	std::shared_ptr<AVFrame> ret = frames.front();
-	if (ret == nullptr) {
-		return nullptr;
-	}
-	frames.pop_front();
+	std::shared_ptr<AVFrame> ret;
+	this->frames.pop(ret);
 	return ret;
 }
 
 bool ffmpeg::avframe_queue::empty()
 {
-	return frames.empty();
+	return this->frames.empty();
 }
 
 size_t ffmpeg::avframe_queue::size()
 {
-	return frames.size();
+	return this->frames.size();
 }
@@ -20,8 +20,9 @@
 // SOFTWARE.
 
 #pragma once
-#include <deque>
-#include <mutex>
+#include <atomic>
+#include "avframe-pool.hpp"
+#include "ring-buffer.hpp"
 
 extern "C" {
 #pragma warning(push)
@@ -31,17 +32,19 @@ extern "C" {
 }
 
 namespace ffmpeg {
+	// Bounded lock-free frame queue, any number of threads may push and pop concurrently.
 	class avframe_queue {
-		std::deque<std::shared_ptr<AVFrame>> frames;
-		std::mutex                           lock;
+		obsffmpeg::mpmc_ring<std::shared_ptr<AVFrame>> frames;
+		avframe_pool                                   pool;
 
-		std::pair<uint32_t, uint32_t> resolution;
-		AVPixelFormat                 format = AV_PIX_FMT_NONE;
+		std::atomic<uint32_t>      frame_width;
+		std::atomic<uint32_t>      frame_height;
+		std::atomic<AVPixelFormat> frame_format;
 
 		std::shared_ptr<AVFrame> create_frame();
 
 		public:
-		avframe_queue();
+		avframe_queue(size_t capacity = 64);
 		~avframe_queue();
 
 		void     set_resolution(uint32_t width, uint32_t height);
@@ -52,11 +55,14 @@ namespace ffmpeg {
 		void          set_pixel_format(AVPixelFormat format);
 		AVPixelFormat get_pixel_format();
 
+		avframe_pool& get_pool();
+
 		void precache(size_t count);
 
 		void clear();
 
-		void push(std::shared_ptr<AVFrame> frame);
+		// Returns false if the queue is full.
+		bool push(std::shared_ptr<AVFrame> frame);
 
 		std::shared_ptr<AVFrame> pop();
 
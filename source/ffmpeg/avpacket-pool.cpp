@@ -0,0 +1,175 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "avpacket-pool.hpp"
+
+// Smallest size class, anything below is rounded up to this.
+static constexpr size_t class_minimum_size = 4096;
+// Number of size classes, the largest one is class_minimum_size * 2^(class_count / 2) (256 MB).
+static constexpr size_t class_count = 32;
+// Check for cold classes every this many requests.
+static constexpr uint64_t retire_interval = 256;
+// Classes that were not requested for this many requests are retired.
+static constexpr uint64_t retire_age = 2048;
+// Maximum number of AVPacket structures kept around for reuse.
+static constexpr size_t packet_cache_size = 32;
+
+static size_t class_index(size_t size)
+{
+	size_t idx = 0;
+	for (size_t csize = class_minimum_size; csize < size; idx++) {
+		// Alternate between x1.5 and x1.333 to get two classes per octave on page aligned sizes.
+		csize = (idx & 1) ? ((csize / 3) * 4) : ((csize / 2) * 3);
+	}
+	return idx;
+}
+
+static size_t class_size(size_t idx)
+{
+	size_t csize = class_minimum_size;
+	for (size_t n = 0; n < idx; n++) {
+		csize = (n & 1) ? ((csize / 3) * 4) : ((csize / 2) * 3);
+	}
+	return csize;
+}
+
+ffmpeg::avpacket_pool::avpacket_pool()
+{
+	this->classes.resize(class_count);
+	for (size_t idx = 0; idx < this->classes.size(); idx++) {
+		this->classes[idx].size = class_size(idx);
+	}
+}
+
+ffmpeg::avpacket_pool::~avpacket_pool()
+{
+	// Buffers still held elsewhere keep their AVBufferPool alive until they are released.
+	for (auto& cls : this->classes) {
+		if (cls.pool)
+			av_buffer_pool_uninit(&cls.pool);
+	}
+	for (auto pkt : this->packets) {
+		av_packet_free(&pkt);
+	}
+}
+
+bool ffmpeg::avpacket_pool::attach(AVCodecContext* context)
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 134, 100)
+	if ((context->codec == nullptr) || ((context->codec->capabilities & AV_CODEC_CAP_DR1) == 0))
+		return false;
+
+	context->opaque            = this;
+	context->get_encode_buffer = &avpacket_pool::get_encode_buffer;
+	return true;
+#else
+	return false;
+#endif
+}
+
+AVBufferRef* ffmpeg::avpacket_pool::get_buffer(size_t size)
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+
+	this->requests++;
+	if ((this->requests % retire_interval) == 0)
+		retire_cold_classes();
+
+	size_t idx = class_index(size);
+	if (idx >= this->classes.size()) {
+		// Larger than anything we pool, allocate it directly.
+		return av_buffer_alloc(static_cast<int>(size));
+	}
+
+	auto& cls     = this->classes[idx];
+	cls.last_used = this->requests;
+	if (!cls.pool) {
+		cls.pool = av_buffer_pool_init(static_cast<int>(cls.size), av_buffer_alloc);
+		if (!cls.pool)
+			return nullptr;
+	}
+	return av_buffer_pool_get(cls.pool);
+}
+
+void ffmpeg::avpacket_pool::retire_cold_classes()
+{
+	for (auto& cls : this->classes) {
+		if (cls.pool && ((this->requests - cls.last_used) > retire_age))
+			av_buffer_pool_uninit(&cls.pool);
+	}
+}
+
+AVPacket* ffmpeg::avpacket_pool::acquire_packet()
+{
+	{
+		std::unique_lock<std::mutex> ulock(this->lock);
+		if (this->packets.size() > 0) {
+			AVPacket* pkt = this->packets.back();
+			this->packets.pop_back();
+			return pkt;
+		}
+	}
+	return av_packet_alloc();
+}
+
+void ffmpeg::avpacket_pool::release_packet(AVPacket* packet)
+{
+	if (!packet)
+		return;
+
+	// Returns the payload to its size class.
+	av_packet_unref(packet);
+
+	{
+		std::unique_lock<std::mutex> ulock(this->lock);
+		if (this->packets.size() < packet_cache_size) {
+			this->packets.push_back(packet);
+			return;
+		}
+	}
+	av_packet_free(&packet);
+}
+
+size_t ffmpeg::avpacket_pool::get_class_count()
+{
+	std::unique_lock<std::mutex> ulock(this->lock);
+	size_t                       count = 0;
+	for (auto& cls : this->classes) {
+		if (cls.pool)
+			count++;
+	}
+	return count;
+}
+
+int ffmpeg::avpacket_pool::get_encode_buffer(AVCodecContext* context, AVPacket* packet, int)
+{
+	auto self = reinterpret_cast<avpacket_pool*>(context->opaque);
+
+	// libavcodec zeroes the padding itself, we only need to make room for it.
+	AVBufferRef* buf = self->get_buffer(static_cast<size_t>(packet->size) + AV_INPUT_BUFFER_PADDING_SIZE);
+	if (!buf)
+		return AVERROR(ENOMEM);
+
+	packet->buf  = buf;
+	packet->data = buf->data;
+	return 0;
+}
@@ -0,0 +1,73 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <cinttypes>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#pragma warning(pop)
+}
+
+namespace ffmpeg {
+	// Pool for encoded packet payloads.
+	// Sizes are rounded up to geometric size classes (two per octave), each backed by its own AVBufferPool. Classes
+	// are only created once a packet of that size is actually requested and are retired again once they go cold,
+	// so the pool follows the packet size distribution of the stream instead of reserving for the worst case.
+	class avpacket_pool {
+		struct size_class {
+			size_t        size      = 0;
+			AVBufferPool* pool      = nullptr;
+			uint64_t      last_used = 0;
+		};
+
+		std::mutex              lock;
+		std::vector<size_class> classes;
+		std::vector<AVPacket*>  packets;
+		uint64_t                requests = 0;
+
+		void retire_cold_classes();
+
+		public:
+		avpacket_pool();
+		~avpacket_pool();
+
+		// Attach the pool to a codec context, must be called before avcodec_open2.
+		// Returns false if the codec or the FFmpeg version does not allow custom packet buffers.
+		bool attach(AVCodecContext* context);
+
+		AVBufferRef* get_buffer(size_t size);
+
+		AVPacket* acquire_packet();
+
+		void release_packet(AVPacket* packet);
+
+		size_t get_class_count();
+
+		static int get_encode_buffer(AVCodecContext* context, AVPacket* packet, int flags);
+	};
+} // namespace ffmpeg
@@ -20,8 +20,20 @@
 // SOFTWARE.
 
 #include "swscale.hpp"
+#include <algorithm>
 #include <stdexcept>
 
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixdesc.h>
+#pragma warning(pop)
+}
+
+// Bands start on multiples of this, which keeps chroma subsampling and the 8x8 dither pattern of swscale aligned
+// with the full frame.
+static constexpr uint32_t band_alignment = 16;
+
 ffmpeg::swscale::swscale() {}
 
 ffmpeg::swscale::~swscale()
@@ -155,6 +167,78 @@ bool ffmpeg::swscale::is_target_full_range()
 	return this->target_full_range;
 }
 
+void ffmpeg::swscale::set_threads(std::shared_ptr<obsffmpeg::threadpool> threads)
+{
+	this->threads = threads;
+}
+
+std::shared_ptr<obsffmpeg::threadpool> ffmpeg::swscale::get_threads()
+{
+	return this->threads;
+}
+
+void ffmpeg::swscale::set_band_count(uint32_t count)
+{
+	this->band_count = count ? count : 1;
+}
+
+uint32_t ffmpeg::swscale::get_band_count()
+{
+	return this->bands.size() ? static_cast<uint32_t>(this->bands.size()) : 1;
+}
+
+SwsContext* ffmpeg::swscale::create_context(int flags, uint32_t source_height, uint32_t target_height)
+{
+	SwsContext* ctx = sws_getContext(source_size.first, source_height, source_format, target_size.first,
+	                                 target_height, target_format, flags, nullptr, nullptr, nullptr);
+	if (!ctx) {
+		return nullptr;
+	}
+
+	sws_setColorspaceDetails(ctx, sws_getCoefficients(source_colorspace), source_full_range ? 1 : 0,
+	                         sws_getCoefficients(target_colorspace), target_full_range ? 1 : 0, 1L << 16 | 0L,
+	                         1L << 16 | 0L, 1L << 16 | 0L);
+	return ctx;
+}
+
+void ffmpeg::swscale::initialize_bands(int flags)
+{
+	if ((this->band_count <= 1) || !this->threads || (this->threads->size() <= 1))
+		return;
+
+	// Rows can only be converted independently if there is no vertical scaling involved.
+	int source_h_shift, source_v_shift, target_h_shift, target_v_shift;
+	av_pix_fmt_get_chroma_sub_sample(source_format, &source_h_shift, &source_v_shift);
+	av_pix_fmt_get_chroma_sub_sample(target_format, &target_h_shift, &target_v_shift);
+	if ((source_size.second != target_size.second) || (source_v_shift != target_v_shift))
+		return;
+
+	uint32_t rows = (source_size.second + this->band_count - 1) / this->band_count;
+	rows          = (rows + band_alignment - 1) / band_alignment * band_alignment;
+	for (uint32_t row = 0; row < source_size.second; row += rows) {
+		band b;
+		b.row     = row;
+		b.rows    = std::min(rows, source_size.second - row);
+		b.context = create_context(flags, b.rows, b.rows);
+		if (!b.context) {
+			// Fall back to the single context.
+			for (auto& other : this->bands) {
+				sws_freeContext(other.context);
+			}
+			this->bands.clear();
+			return;
+		}
+		this->bands.push_back(b);
+	}
+
+	if (this->bands.size() <= 1) {
+		for (auto& other : this->bands) {
+			sws_freeContext(other.context);
+		}
+		this->bands.clear();
+	}
+}
+
 bool ffmpeg::swscale::initialize(int flags)
 {
 	if (this->context) {
@@ -169,21 +253,23 @@ bool ffmpeg::swscale::initialize(int flags)
 		throw std::invalid_argument("not all target parameters were set");
 	}
 
-	this->context = sws_getContext(source_size.first, source_size.second, source_format, target_size.first,
-	                               target_size.second, target_format, flags, nullptr, nullptr, nullptr);
+	this->context = create_context(flags, source_size.second, target_size.second);
 	if (!this->context) {
 		return false;
 	}
 
-	sws_setColorspaceDetails(this->context, sws_getCoefficients(source_colorspace), source_full_range ? 1 : 0,
-	                         sws_getCoefficients(target_colorspace), target_full_range ? 1 : 0, 1L << 16 | 0L,
-	                         1L << 16 | 0L, 1L << 16 | 0L);
+	initialize_bands(flags);
 
 	return true;
 }
 
 bool ffmpeg::swscale::finalize()
 {
+	for (auto& b : this->bands) {
+		sws_freeContext(b.context);
+	}
+	this->bands.clear();
+
 	if (this->context) {
 		sws_freeContext(this->context);
 		this->context = nullptr;
@@ -198,6 +284,43 @@ int32_t ffmpeg::swscale::convert(const uint8_t* const source_data[], const int s
 	if (!this->context) {
 		return 0;
 	}
+
+	if ((this->bands.size() > 0) && (source_row == 0)
+	    && (static_cast<uint32_t>(source_rows) == source_size.second)) {
+		int source_h_shift, source_v_shift, target_h_shift, target_v_shift;
+		av_pix_fmt_get_chroma_sub_sample(source_format, &source_h_shift, &source_v_shift);
+		av_pix_fmt_get_chroma_sub_sample(target_format, &target_h_shift, &target_v_shift);
+		int source_planes = av_pix_fmt_count_planes(source_format);
+		int target_planes = av_pix_fmt_count_planes(target_format);
+
+		std::vector<int32_t> heights(this->bands.size(), 0);
+		this->threads->parallel_for(this->bands.size(), [&](size_t idx) {
+			auto& b = this->bands[idx];
+
+			const uint8_t* source_band[4] = {nullptr, nullptr, nullptr, nullptr};
+			uint8_t*       target_band[4] = {nullptr, nullptr, nullptr, nullptr};
+			for (int plane = 0; plane < source_planes; plane++) {
+				ptrdiff_t row      = ((plane == 1) || (plane == 2)) ? (b.row >> source_v_shift) : b.row;
+				source_band[plane] = source_data[plane] + source_stride[plane] * row;
+			}
+			for (int plane = 0; plane < target_planes; plane++) {
+				ptrdiff_t row      = ((plane == 1) || (plane == 2)) ? (b.row >> target_v_shift) : b.row;
+				target_band[plane] = target_data[plane] + target_stride[plane] * row;
+			}
+
+			heights[idx] = sws_scale(b.context, source_band, source_stride, 0, static_cast<int>(b.rows),
+			                         target_band, target_stride);
+		});
+
+		int32_t height = 0;
+		for (auto h : heights) {
+			if (h <= 0)
+				return h;
+			height += h;
+		}
+		return height;
+	}
+
 	int height =
 	    sws_scale(this->context, source_data, source_stride, source_row, source_rows, target_data, target_stride);
 	return height;
@@ -24,7 +24,10 @@
 #pragma once
 
 #include <cinttypes>
+#include <memory>
 #include <utility>
+#include <vector>
+#include "threadpool.hpp"
 
 extern "C" {
 #pragma warning(push)
@@ -48,6 +51,20 @@ namespace ffmpeg {
 
 		SwsContext* context = nullptr;
 
+		// Band-parallel conversion, every band has its own context covering only its rows.
+		struct band {
+			uint32_t    row;
+			uint32_t    rows;
+			SwsContext* context;
+		};
+		std::vector<band>                      bands;
+		uint32_t                               band_count = 1;
+		std::shared_ptr<obsffmpeg::threadpool> threads;
+
+		SwsContext* create_context(int flags, uint32_t source_height, uint32_t target_height);
+
+		void initialize_bands(int flags);
+
 		public:
 		swscale();
 		~swscale();
@@ -78,6 +95,12 @@ namespace ffmpeg {
 		void                          set_target_full_range(bool full_range);
 		bool                          is_target_full_range();
 
+		// Bands are converted on the given thread pool, if the conversion allows for it.
+		void                                   set_threads(std::shared_ptr<obsffmpeg::threadpool> threads);
+		std::shared_ptr<obsffmpeg::threadpool> get_threads();
+		void                                   set_band_count(uint32_t count);
+		uint32_t                               get_band_count();
+
 		bool initialize(int flags);
 		bool finalize();
 
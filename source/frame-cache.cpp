@@ -0,0 +1,111 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "frame-cache.hpp"
+#include <algorithm>
+#include <tuple>
+#include "shared-registry.hpp"
+
+// Entries kept at most, in case subscribers stop taking them.
+static constexpr size_t max_entries = 4;
+
+static obsffmpeg::shared_registry<obsffmpeg::frame_cache_key, obsffmpeg::frame_cache> registry;
+
+bool obsffmpeg::frame_cache_key::operator<(const frame_cache_key& other) const
+{
+	return std::tie(source_format, format, width, height, full_range, colorspace, fps_num, fps_den)
+	       < std::tie(other.source_format, other.format, other.width, other.height, other.full_range,
+	                  other.colorspace, other.fps_num, other.fps_den);
+}
+
+obsffmpeg::frame_cache::frame_cache(uint32_t fps_num, uint32_t fps_den)
+    : _subscribers(0), _max_age(get_shared_frame_max_age(fps_num, fps_den))
+{}
+
+obsffmpeg::frame_cache::~frame_cache() {}
+
+std::shared_ptr<obsffmpeg::frame_cache> obsffmpeg::frame_cache::subscribe(const frame_cache_key& key)
+{
+	std::shared_ptr<frame_cache> cache =
+	    registry.acquire(key, [&key]() { return std::make_shared<frame_cache>(key.fps_num, key.fps_den); });
+
+	std::unique_lock<std::mutex> ulock(cache->_lock);
+	cache->_subscribers++;
+	return cache;
+}
+
+void obsffmpeg::frame_cache::unsubscribe()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	if (_subscribers > 0)
+		_subscribers--;
+
+	// Entries waiting for the one that left would otherwise only go once they are too old.
+	_entries.erase(std::remove_if(_entries.begin(), _entries.end(),
+	                              [this](entry const& e) { return e.consumed >= _subscribers; }),
+	               _entries.end());
+}
+
+size_t obsffmpeg::frame_cache::get_subscriber_count()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return _subscribers;
+}
+
+void obsffmpeg::frame_cache::evict()
+{
+	auto now = std::chrono::steady_clock::now();
+	while (!_entries.empty()
+	       && (((now - _entries.front().inserted) > _max_age) || (_entries.size() > max_entries))) {
+		_entries.pop_front();
+	}
+}
+
+std::shared_ptr<AVFrame> obsffmpeg::frame_cache::find(const uint8_t* source)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	evict();
+
+	auto it =
+	    std::find_if(_entries.begin(), _entries.end(), [source](entry const& e) { return e.source == source; });
+	if (it == _entries.end())
+		return nullptr;
+
+	std::shared_ptr<AVFrame> frame = it->frame;
+	if (++it->consumed >= _subscribers)
+		_entries.erase(it);
+	return frame;
+}
+
+void obsffmpeg::frame_cache::insert(const uint8_t* source, std::shared_ptr<AVFrame> frame)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	if (_subscribers <= 1)
+		return;
+
+	// The same input converted again replaces what is left of the earlier entry.
+	_entries.erase(std::remove_if(_entries.begin(), _entries.end(),
+	                              [source](entry const& e) { return e.source == source; }),
+	               _entries.end());
+	_entries.push_back({source, frame, 1, std::chrono::steady_clock::now()});
+	evict();
+}
@@ -0,0 +1,88 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	// Everything that decides what a converted frame looks like, apart from the input itself.
+	struct frame_cache_key {
+		AVPixelFormat source_format;
+		AVPixelFormat format;
+		uint32_t      width;
+		uint32_t      height;
+		bool          full_range;
+		AVColorSpace  colorspace;
+		uint32_t      fps_num;
+		uint32_t      fps_den;
+
+		bool operator<(const frame_cache_key& other) const;
+	};
+
+	// Converted frames shared across the whole process between encoders that convert the same input the same way.
+	// The first subscriber to see an input converts it, the others take a reference to the result. Inputs are
+	// told apart by the address of their first plane, which OBS hands to every encoder of the same canvas and
+	// size during a video frame, so entries only match during the video frame they were converted in.
+	class frame_cache {
+		struct entry {
+			const uint8_t*                        source;
+			std::shared_ptr<AVFrame>              frame;
+			size_t                                consumed;
+			std::chrono::steady_clock::time_point inserted;
+		};
+
+		std::mutex               _lock;
+		size_t                   _subscribers;
+		std::deque<entry>        _entries;
+		std::chrono::nanoseconds _max_age;
+
+		void evict();
+
+		public:
+		frame_cache(uint32_t fps_num, uint32_t fps_den);
+		~frame_cache();
+
+		static std::shared_ptr<frame_cache> subscribe(const frame_cache_key& key);
+
+		void unsubscribe();
+
+		size_t get_subscriber_count();
+
+		// The converted frame of this input, if another subscriber already converted it.
+		std::shared_ptr<AVFrame> find(const uint8_t* source);
+
+		// Offers a converted frame to the other subscribers, until all of them took it or it is too old.
+		void insert(const uint8_t* source, std::shared_ptr<AVFrame> frame);
+	};
+} // namespace obsffmpeg
@@ -0,0 +1,259 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "governor.hpp"
+#include <algorithm>
+#include <sstream>
+
+// Scales of each level, in percent of the full resolution.
+static const uint32_t scales[] = {100, 75, 66, 50};
+
+// Sizes are kept to multiples of this, which satisfies the chroma subsampling of every format we encode to.
+static constexpr uint32_t size_alignment = 8;
+
+// Overloaded frames in a row before stepping down.
+static constexpr double_t down_load_limit = 0.85;
+static constexpr size_t   down_frames     = 30;
+
+// Frames in a row that would still have headroom at the next larger level before stepping up.
+static constexpr double_t up_load_limit = 0.6;
+static constexpr size_t   up_frames     = 300;
+
+// Frames ignored after a switch, reopening the encoder makes the first few slow.
+static constexpr size_t cooldown_frames = 60;
+
+// Frames averaged at a new preset level before its cost relative to the previous one is known.
+static constexpr size_t measure_frames = 60;
+
+// Assumed cost of a slower preset level relative to a faster one, until it was measured.
+static constexpr double_t default_cost = 1.5;
+
+static constexpr double_t load_weight = 0.1;
+
+obsffmpeg::resolution_governor::resolution_governor()
+    : _level(0), _interval(0), _load(0), _over(0), _under(0), _cooldown(0), _switches(0)
+{}
+
+void obsffmpeg::resolution_governor::initialize(uint32_t width, uint32_t height, uint32_t fps_num,
+                                                uint32_t fps_den)
+{
+	_levels.clear();
+	_level = _over = _under = _cooldown = 0;
+	_load                               = 0;
+	_switches                           = 0;
+	if ((fps_num == 0) || (fps_den == 0))
+		return;
+	_interval = static_cast<double_t>(fps_den) / static_cast<double_t>(fps_num);
+
+	_levels.emplace_back(width, height);
+	for (size_t idx = 1; idx < (sizeof(scales) / sizeof(scales[0])); idx++) {
+		uint32_t w = (width * scales[idx] / 100) / size_alignment * size_alignment;
+		uint32_t h = (height * scales[idx] / 100) / size_alignment * size_alignment;
+		if ((w == 0) || (h == 0) || ((w == _levels.back().first) && (h == _levels.back().second)))
+			break;
+		_levels.emplace_back(w, h);
+	}
+
+	// A single level leaves nothing to govern.
+	if (_levels.size() < 2)
+		_levels.clear();
+}
+
+bool obsffmpeg::resolution_governor::is_valid()
+{
+	return !_levels.empty();
+}
+
+bool obsffmpeg::resolution_governor::update(std::chrono::nanoseconds time)
+{
+	if (_cooldown > 0) {
+		_cooldown--;
+		return false;
+	}
+
+	double_t load = std::chrono::duration<double_t>(time).count() / _interval;
+	_load         = _load * (1.0 - load_weight) + load * load_weight;
+
+	// Work grows with the number of pixels, so estimate the load one level up from the ratio of areas.
+	double_t up_load = 0;
+	if (_level > 0) {
+		double_t area    = static_cast<double_t>(_levels[_level].first) * _levels[_level].second;
+		double_t up_area = static_cast<double_t>(_levels[_level - 1].first) * _levels[_level - 1].second;
+		up_load          = _load * up_area / area;
+	}
+
+	_over  = (_load > down_load_limit) ? _over + 1 : 0;
+	_under = ((_level > 0) && (up_load < up_load_limit)) ? _under + 1 : 0;
+
+	size_t level = _level;
+	if ((_over >= down_frames) && ((_level + 1) < _levels.size())) {
+		level++;
+	} else if (_under >= up_frames) {
+		level--;
+	}
+	if (level == _level)
+		return false;
+
+	// Start measuring the new level from a neutral estimate.
+	double_t area     = static_cast<double_t>(_levels[_level].first) * _levels[_level].second;
+	double_t new_area = static_cast<double_t>(_levels[level].first) * _levels[level].second;
+	_load             = _load * new_area / area;
+	_level            = level;
+	_over = _under = 0;
+	_cooldown      = cooldown_frames;
+	_switches++;
+	return true;
+}
+
+size_t obsffmpeg::resolution_governor::get_level()
+{
+	return _level;
+}
+
+size_t obsffmpeg::resolution_governor::get_level_count()
+{
+	return _levels.size();
+}
+
+std::pair<uint32_t, uint32_t> obsffmpeg::resolution_governor::get_size()
+{
+	return _levels[_level];
+}
+
+double_t obsffmpeg::resolution_governor::get_load()
+{
+	return _load;
+}
+
+uint64_t obsffmpeg::resolution_governor::get_switch_count()
+{
+	return _switches;
+}
+
+obsffmpeg::preset_governor::preset_governor()
+    : _level(0), _interval(0), _load(0), _over(0), _under(0), _cooldown(0), _switches(0), _previous_level(0),
+      _previous_load(0), _measure(0)
+{}
+
+void obsffmpeg::preset_governor::initialize(const char* levels, uint32_t fps_num, uint32_t fps_den)
+{
+	_levels.clear();
+	_costs.clear();
+	_level = _over = _under = _cooldown = _measure = 0;
+	_load                                          = 0;
+	_switches                                      = 0;
+	if (!levels || (fps_num == 0) || (fps_den == 0))
+		return;
+	_interval = static_cast<double_t>(fps_den) / static_cast<double_t>(fps_num);
+
+	std::stringstream sstr(levels);
+	std::string       level;
+	while (std::getline(sstr, level, '|')) {
+		if (!level.empty())
+			_levels.push_back(level);
+	}
+
+	// A single level leaves nothing to govern.
+	if (_levels.size() < 2) {
+		_levels.clear();
+		return;
+	}
+
+	// Cost of each level relative to the next faster one.
+	_costs.assign(_levels.size(), default_cost);
+}
+
+bool obsffmpeg::preset_governor::is_valid()
+{
+	return !_levels.empty();
+}
+
+bool obsffmpeg::preset_governor::update(std::chrono::nanoseconds time)
+{
+	if (_cooldown > 0) {
+		_cooldown--;
+		return false;
+	}
+
+	double_t load = std::chrono::duration<double_t>(time).count() / _interval;
+	_load         = _load * (1.0 - load_weight) + load * load_weight;
+
+	// Once the new level had time to settle, remember how it compares to the one before.
+	if (_measure > 0) {
+		if (--_measure == 0) {
+			size_t slow = std::min(_previous_level, _level);
+			if ((_previous_level < _level) && (_load > 0)) {
+				_costs[slow] = std::max(1.0, _previous_load / _load);
+			} else if ((_previous_level > _level) && (_previous_load > 0)) {
+				_costs[slow] = std::max(1.0, _load / _previous_load);
+			}
+		}
+		return false;
+	}
+
+	double_t up_load = (_level > 0) ? (_load * _costs[_level - 1]) : 0;
+
+	_over  = (_load > down_load_limit) ? _over + 1 : 0;
+	_under = ((_level > 0) && (up_load < up_load_limit)) ? _under + 1 : 0;
+
+	size_t level = _level;
+	if ((_over >= down_frames) && ((_level + 1) < _levels.size())) {
+		level++;
+	} else if (_under >= up_frames) {
+		level--;
+	}
+	if (level == _level)
+		return false;
+
+	_previous_level = _level;
+	_previous_load  = _load;
+	_level          = level;
+	_over = _under = 0;
+	_cooldown      = cooldown_frames;
+	_measure       = measure_frames;
+	_switches++;
+	return true;
+}
+
+size_t obsffmpeg::preset_governor::get_level()
+{
+	return _level;
+}
+
+size_t obsffmpeg::preset_governor::get_level_count()
+{
+	return _levels.size();
+}
+
+const std::string& obsffmpeg::preset_governor::get_options()
+{
+	return _levels[_level];
+}
+
+double_t obsffmpeg::preset_governor::get_load()
+{
+	return _load;
+}
+
+uint64_t obsffmpeg::preset_governor::get_switch_count()
+{
+	return _switches;
+}
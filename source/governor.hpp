@@ -0,0 +1,108 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace obsffmpeg {
+	// Watches how long frames take compared to the frame interval, and picks a smaller encode resolution while
+	// the encoder can't keep up. Stepping back up needs clear headroom for a while, so it does not oscillate.
+	class resolution_governor {
+		std::vector<std::pair<uint32_t, uint32_t>> _levels;
+		size_t                                     _level;
+
+		double_t _interval;
+		double_t _load;
+		size_t   _over;
+		size_t   _under;
+		size_t   _cooldown;
+		uint64_t _switches;
+
+		public:
+		resolution_governor();
+
+		// Level 0 is the full resolution, every further level is smaller.
+		void initialize(uint32_t width, uint32_t height, uint32_t fps_num, uint32_t fps_den);
+
+		bool is_valid();
+
+		// Feeds the time a frame took, returns true if the level changed.
+		bool update(std::chrono::nanoseconds time);
+
+		size_t get_level();
+
+		size_t get_level_count();
+
+		std::pair<uint32_t, uint32_t> get_size();
+
+		// Average time per frame relative to the frame interval.
+		double_t get_load();
+
+		uint64_t get_switch_count();
+	};
+
+	// Moves along a list of encoder option sets, ordered from slowest to fastest, depending on how long frames
+	// take compared to the frame interval. How much cheaper a level is gets measured whenever it is entered, so
+	// stepping back up is only tried when the slower level is expected to fit again.
+	class preset_governor {
+		std::vector<std::string> _levels;
+		std::vector<double_t>    _costs;
+		size_t                   _level;
+
+		double_t _interval;
+		double_t _load;
+		size_t   _over;
+		size_t   _under;
+		size_t   _cooldown;
+		uint64_t _switches;
+
+		// Load before the last switch, to measure the cost of the new level against.
+		size_t   _previous_level;
+		double_t _previous_load;
+		size_t   _measure;
+
+		public:
+		preset_governor();
+
+		// Levels are separated by '|', and each level is a ';' separated list of key=value options.
+		void initialize(const char* levels, uint32_t fps_num, uint32_t fps_den);
+
+		bool is_valid();
+
+		// Feeds the time a frame took, returns true if the level changed.
+		bool update(std::chrono::nanoseconds time);
+
+		size_t get_level();
+
+		size_t get_level_count();
+
+		const std::string& get_options();
+
+		double_t get_load();
+
+		uint64_t get_switch_count();
+	};
+} // namespace obsffmpeg
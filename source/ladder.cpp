@@ -0,0 +1,228 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "ladder.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "shared-registry.hpp"
+
+static obsffmpeg::shared_registry<std::string, obsffmpeg::ladder> registry;
+
+obsffmpeg::ladder::ladder(AVPixelFormat format, bool full_range, AVColorSpace colorspace, uint32_t fps_num,
+                          uint32_t fps_den, uint32_t gop_size)
+    : _format(format), _full_range(full_range), _colorspace(colorspace), _fps_num(fps_num), _fps_den(fps_den),
+      _gop_size(gop_size), _max_age(get_shared_frame_max_age(fps_num, fps_den)), _leader(0), _dirty(true),
+      _source(nullptr), _keyframe(false), _sequence(0)
+{}
+
+obsffmpeg::ladder::~ladder() {}
+
+std::shared_ptr<obsffmpeg::ladder> obsffmpeg::ladder::join(const std::string& name, const void* owner,
+                                                           uint32_t width, uint32_t height, AVPixelFormat format,
+                                                           bool full_range, AVColorSpace colorspace,
+                                                           uint32_t fps_num, uint32_t fps_den, uint32_t gop_size)
+{
+	std::shared_ptr<ladder> group = registry.acquire(name, [&]() {
+		return std::make_shared<ladder>(format, full_range, colorspace, fps_num, fps_den, gop_size);
+	});
+	if ((group->_format != format) || (group->_full_range != full_range) || (group->_colorspace != colorspace)
+	    || (static_cast<uint64_t>(group->_fps_num) * fps_den != static_cast<uint64_t>(fps_num) * group->_fps_den)
+	    || (group->_gop_size != gop_size)) {
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> ulock(group->_lock);
+	group->_members.push_back({owner, width, height, 0});
+	group->_leader = group->find_leader();
+	group->_dirty  = true;
+	return group;
+}
+
+void obsffmpeg::ladder::leave(const void* owner)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	_members.erase(std::remove_if(_members.begin(), _members.end(),
+	                              [owner](member const& m) { return m.owner == owner; }),
+	               _members.end());
+	_leader = find_leader();
+	_dirty  = true;
+
+	// Whoever leads now publishes again with the next frame.
+	_frame = nullptr;
+}
+
+bool obsffmpeg::ladder::is_leader(const void* owner)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return (_leader < _members.size()) && (_members[_leader].owner == owner);
+}
+
+size_t obsffmpeg::ladder::get_member_count()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return _members.size();
+}
+
+size_t obsffmpeg::ladder::get_level_count()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return _levels.size();
+}
+
+size_t obsffmpeg::ladder::find_leader()
+{
+	// The largest member, and the one that joined first among equals.
+	size_t leader = 0;
+	for (size_t idx = 1; idx < _members.size(); idx++) {
+		uint64_t area = static_cast<uint64_t>(_members[idx].width) * _members[idx].height;
+		if (area > static_cast<uint64_t>(_members[leader].width) * _members[leader].height)
+			leader = idx;
+	}
+	return leader;
+}
+
+void obsffmpeg::ladder::rebuild()
+{
+	_levels.clear();
+	_dirty = false;
+	if (_leader >= _members.size())
+		return;
+
+	// Sizes that can be made from the leader's frame without stretching it, each of them once.
+	const member&                              lead = _members[_leader];
+	std::vector<std::pair<uint32_t, uint32_t>> sizes;
+	for (auto& m : _members) {
+		if ((m.width > lead.width) || (m.height > lead.height)
+		    || ((m.width == lead.width) && (m.height == lead.height)))
+			continue;
+		sizes.emplace_back(m.width, m.height);
+	}
+	auto area = [](std::pair<uint32_t, uint32_t> const& size) {
+		return static_cast<uint64_t>(size.first) * size.second;
+	};
+	std::sort(sizes.begin(), sizes.end(),
+	          [&area](std::pair<uint32_t, uint32_t> const& a, std::pair<uint32_t, uint32_t> const& b) {
+		          return (area(a) != area(b)) ? (area(a) > area(b)) : (a > b);
+	          });
+	sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+	for (auto& size : sizes) {
+		level lvl;
+		lvl.width  = size.first;
+		lvl.height = size.second;
+
+		// Scale from the smallest level that still covers this one, which is cheaper than from the top.
+		lvl.source = -1;
+		for (size_t idx = _levels.size(); idx > 0; idx--) {
+			if ((_levels[idx - 1].width >= lvl.width) && (_levels[idx - 1].height >= lvl.height)) {
+				lvl.source = static_cast<ptrdiff_t>(idx - 1);
+				break;
+			}
+		}
+		uint32_t source_width  = (lvl.source < 0) ? lead.width : _levels[lvl.source].width;
+		uint32_t source_height = (lvl.source < 0) ? lead.height : _levels[lvl.source].height;
+
+		lvl.scaler = std::make_unique<ffmpeg::swscale>();
+		lvl.scaler->set_source_size(source_width, source_height);
+		lvl.scaler->set_source_format(_format);
+		lvl.scaler->set_source_color(_full_range, _colorspace);
+		lvl.scaler->set_target_size(lvl.width, lvl.height);
+		lvl.scaler->set_target_format(_format);
+		lvl.scaler->set_target_color(_full_range, _colorspace);
+		if (!lvl.scaler->initialize(SWS_BILINEAR))
+			throw std::runtime_error("Failed to initialize scaler for ladder level.");
+
+		lvl.pool = std::make_unique<ffmpeg::avframe_pool>();
+		lvl.pool->set_resolution(lvl.width, lvl.height);
+		lvl.pool->set_pixel_format(_format);
+
+		_levels.push_back(std::move(lvl));
+	}
+}
+
+void obsffmpeg::ladder::publish(const uint8_t* source, std::shared_ptr<AVFrame> frame, bool keyframe)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	if (_dirty)
+		rebuild();
+
+	// A frame of any other size would be stretched into the levels.
+	if ((_leader >= _members.size()) || (static_cast<uint32_t>(frame->width) != _members[_leader].width)
+	    || (static_cast<uint32_t>(frame->height) != _members[_leader].height)) {
+		_frame = nullptr;
+		return;
+	}
+
+	for (auto& lvl : _levels) {
+		AVFrame* source = (lvl.source < 0) ? frame.get() : _levels[lvl.source].frame.get();
+
+		lvl.frame = lvl.pool->get();
+		int res   = lvl.scaler->convert(source->data, source->linesize, 0, source->height, lvl.frame->data,
+		                                lvl.frame->linesize);
+		if (res <= 0)
+			throw std::runtime_error("Failed to scale ladder level.");
+		av_frame_copy_props(lvl.frame.get(), frame.get());
+	}
+
+	_frame     = frame;
+	_source    = source;
+	_keyframe  = keyframe;
+	_published = std::chrono::steady_clock::now();
+	_sequence++;
+}
+
+std::shared_ptr<AVFrame> obsffmpeg::ladder::fetch(const void* owner, const uint8_t* source, uint32_t width,
+                                                  uint32_t height, bool& keyframe)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+
+	auto it = std::find_if(_members.begin(), _members.end(), [owner](member const& m) { return m.owner == owner; });
+	if ((it == _members.end()) || !_frame || (it->consumed == _sequence))
+		return nullptr;
+
+	// Members are kept in the order they joined, which is the order OBS calls them in.
+	if ((source != _source) && (static_cast<size_t>(it - _members.begin()) < _leader))
+		return nullptr;
+
+	// Anything older was published for an earlier video frame, which means the leader skipped this one.
+	if ((std::chrono::steady_clock::now() - _published) > _max_age)
+		return nullptr;
+
+	std::shared_ptr<AVFrame> found;
+	if ((static_cast<uint32_t>(_frame->width) == width) && (static_cast<uint32_t>(_frame->height) == height)) {
+		found = _frame;
+	} else {
+		for (auto& lvl : _levels) {
+			if ((lvl.width == width) && (lvl.height == height)) {
+				found = lvl.frame;
+				break;
+			}
+		}
+	}
+	if (!found)
+		return nullptr;
+
+	it->consumed = _sequence;
+	keyframe     = _keyframe;
+	return found;
+}
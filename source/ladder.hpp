@@ -0,0 +1,126 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ffmpeg/avframe-pool.hpp"
+#include "ffmpeg/swscale.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	// Encoders of the same canvas at different sizes, grouped by name across the whole process.
+	// The largest member leads: it converts its input as usual, and scales the result down once for every other
+	// size in the group, each level from the next larger one. The others pick up their size of the frame during
+	// the same video frame instead of converting their own input, and place keyframes where the leader does.
+	class ladder {
+		struct member {
+			const void* owner;
+			uint32_t    width;
+			uint32_t    height;
+			uint64_t    consumed;
+		};
+
+		struct level {
+			uint32_t                              width;
+			uint32_t                              height;
+			std::unique_ptr<ffmpeg::swscale>      scaler;
+			std::unique_ptr<ffmpeg::avframe_pool> pool;
+			std::shared_ptr<AVFrame>              frame;
+
+			// Index of the level it is scaled from, or -1 for the leader's frame.
+			ptrdiff_t source;
+		};
+
+		std::mutex _lock;
+
+		AVPixelFormat            _format;
+		bool                     _full_range;
+		AVColorSpace             _colorspace;
+		uint32_t                 _fps_num;
+		uint32_t                 _fps_den;
+		uint32_t                 _gop_size;
+		std::chrono::nanoseconds _max_age;
+
+		std::vector<member> _members;
+		size_t              _leader;
+
+		// Every size below the leader's, largest first. Rebuilt whenever the members change.
+		std::vector<level> _levels;
+		bool               _dirty;
+
+		std::shared_ptr<AVFrame>              _frame;
+		const uint8_t*                        _source;
+		bool                                  _keyframe;
+		uint64_t                              _sequence;
+		std::chrono::steady_clock::time_point _published;
+
+		size_t find_leader();
+
+		void rebuild();
+
+		public:
+		ladder(AVPixelFormat format, bool full_range, AVColorSpace colorspace, uint32_t fps_num,
+		       uint32_t fps_den, uint32_t gop_size);
+		~ladder();
+
+		// Joins or creates the named group, returns nullptr if the group encodes a different format, rate or
+		// keyframe interval.
+		static std::shared_ptr<ladder> join(const std::string& name, const void* owner, uint32_t width,
+		                                    uint32_t height, AVPixelFormat format, bool full_range,
+		                                    AVColorSpace colorspace, uint32_t fps_num, uint32_t fps_den,
+		                                    uint32_t gop_size);
+
+		void leave(const void* owner);
+
+		bool is_leader(const void* owner);
+
+		size_t get_member_count();
+
+		size_t get_level_count();
+
+		// Leader only: scales the converted frame into every level and makes them available to the others.
+		// The source is the first plane of the input it was converted from.
+		void publish(const uint8_t* source, std::shared_ptr<AVFrame> frame, bool keyframe);
+
+		// The frame of the given size that the leader published during this video frame, if any. Each member
+		// gets a published frame only once.
+		// A member with the same input as the leader is matched on its first plane, the way the frame cache
+		// does it. OBS scales the input of every other size into buffers of its own, so those can only rely on
+		// OBS calling the encoders of a video frame in the order they were started: only members that joined
+		// after the leader see its frame of the current video frame, the others would get the previous one.
+		std::shared_ptr<AVFrame> fetch(const void* owner, const uint8_t* source, uint32_t width,
+		                               uint32_t height, bool& keyframe);
+	};
+} // namespace obsffmpeg
@@ -0,0 +1,299 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "parallel-encoder.hpp"
+#include <algorithm>
+#include "ffmpeg/tools.hpp"
+#include "utility.hpp"
+
+obsffmpeg::parallel_encoder::parallel_encoder()
+    : _packet_pool(nullptr), _segment_frames(0), _restart(false), _next_lane(0), _stop(false), _failed(false),
+      _segments(0), _wait_time(0)
+{}
+
+obsffmpeg::parallel_encoder::~parallel_encoder()
+{
+	finalize();
+}
+
+void obsffmpeg::parallel_encoder::initialize(size_t lanes, size_t segment_frames, bool restart,
+                                             context_factory factory, ffmpeg::avpacket_pool* packet_pool)
+{
+	finalize();
+	if (lanes < 2)
+		return;
+
+	_factory        = factory;
+	_packet_pool    = packet_pool;
+	_segment_frames = segment_frames;
+	_restart        = restart;
+	_next_lane      = 0;
+	_stop = _failed = false;
+	_segments       = 0;
+	_wait_time      = std::chrono::nanoseconds(0);
+
+	try {
+		for (size_t idx = 0; idx < lanes; idx++) {
+			auto ln     = std::make_unique<lane>();
+			ln->context = _factory();
+			_lanes.push_back(std::move(ln));
+		}
+	} catch (...) {
+		finalize();
+		throw;
+	}
+
+	for (auto& ln : _lanes) {
+		lane* ptr  = ln.get();
+		ln->thread = std::thread([this, ptr]() { lane_main(ptr); });
+	}
+}
+
+void obsffmpeg::parallel_encoder::finalize()
+{
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_stop = true;
+	}
+	_work_cv.notify_all();
+	_done_cv.notify_all();
+
+	for (auto& ln : _lanes) {
+		if (ln->thread.joinable())
+			ln->thread.join();
+		if (ln->context) {
+			avcodec_close(ln->context);
+			avcodec_free_context(&ln->context);
+		}
+	}
+	_lanes.clear();
+
+	// Every segment that wasn't fully returned is still in the order, including those the lanes didn't finish.
+	for (auto& seg : _order) {
+		for (auto pkt : seg->packets) {
+			_packet_pool->release_packet(pkt);
+		}
+	}
+	_order.clear();
+	_current = nullptr;
+}
+
+bool obsffmpeg::parallel_encoder::is_valid()
+{
+	return !_lanes.empty();
+}
+
+bool obsffmpeg::parallel_encoder::has_failed()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return _failed;
+}
+
+size_t obsffmpeg::parallel_encoder::get_lane_count()
+{
+	return _lanes.size();
+}
+
+size_t obsffmpeg::parallel_encoder::get_frame_capacity()
+{
+	return _lanes.size() * std::max<size_t>(_segment_frames, 1);
+}
+
+bool obsffmpeg::parallel_encoder::push(std::shared_ptr<AVFrame> frame)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	if (_failed)
+		return false;
+
+	if (!_current) {
+		auto begin = std::chrono::high_resolution_clock::now();
+		_done_cv.wait(ulock, [this]() {
+			return _failed || (_order.size() < _lanes.size()) || _order.front()->done;
+		});
+		_wait_time += std::chrono::high_resolution_clock::now() - begin;
+		if (_failed)
+			return false;
+
+		_current = std::make_shared<segment>();
+		_order.push_back(_current);
+		_lanes[_next_lane]->segments.push_back(_current);
+		_next_lane = (_next_lane + 1) % _lanes.size();
+		_segments++;
+	}
+
+	_current->frames.push_back(std::move(frame));
+	_current->count++;
+	if ((_segment_frames > 0) && (_current->count >= _segment_frames)) {
+		_current->closed = true;
+		_current         = nullptr;
+	}
+
+	ulock.unlock();
+	_work_cv.notify_all();
+	return true;
+}
+
+void obsffmpeg::parallel_encoder::close_segment()
+{
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		if (!_current)
+			return;
+		_current->closed = true;
+		_current         = nullptr;
+	}
+	_work_cv.notify_all();
+}
+
+bool obsffmpeg::parallel_encoder::pop(AVPacket*& packet)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	while (!_order.empty()) {
+		auto& seg = _order.front();
+		if (!seg->packets.empty()) {
+			packet = seg->packets.front();
+			seg->packets.pop_front();
+			return true;
+		}
+		if (!seg->done)
+			return false;
+		_order.pop_front();
+	}
+	return false;
+}
+
+uint64_t obsffmpeg::parallel_encoder::get_segment_count()
+{
+	return _segments;
+}
+
+size_t obsffmpeg::parallel_encoder::get_pending_segments()
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	return _order.size();
+}
+
+std::chrono::nanoseconds obsffmpeg::parallel_encoder::get_wait_time()
+{
+	return _wait_time;
+}
+
+void obsffmpeg::parallel_encoder::lane_main(lane* ln)
+{
+	std::unique_lock<std::mutex> ulock(_lock);
+	while (true) {
+		_work_cv.wait(ulock, [this, ln]() {
+			return _stop || _failed
+			       || (!ln->segments.empty()
+			           && (!ln->segments.front()->frames.empty() || ln->segments.front()->closed));
+		});
+		if (_stop || _failed)
+			return;
+
+		std::shared_ptr<segment> seg = ln->segments.front();
+		std::deque<AVPacket*>    packets;
+		bool                     ok = true;
+		if (!seg->frames.empty()) {
+			std::shared_ptr<AVFrame> frame = seg->frames.front();
+			seg->frames.pop_front();
+
+			ulock.unlock();
+			ok    = encode(ln->context, frame.get(), packets);
+			frame = nullptr;
+			ulock.lock();
+		} else {
+			// Every frame of the segment was sent, so finish it off. Packets only belong to the segment
+			// if the context gives them all up before the next one starts.
+			ulock.unlock();
+			if (_restart) {
+				ok = encode(ln->context, nullptr, packets);
+				try {
+					AVCodecContext* context = _factory();
+					avcodec_close(ln->context);
+					avcodec_free_context(&ln->context);
+					ln->context = context;
+				} catch (std::exception const& ex) {
+					PLOG_ERROR("Failed to restart parallel encoder: %s", ex.what());
+					ok = false;
+				}
+			}
+			ulock.lock();
+
+			seg->done = true;
+			ln->segments.pop_front();
+		}
+
+		seg->packets.insert(seg->packets.end(), packets.begin(), packets.end());
+		if (!ok)
+			_failed = true;
+		_done_cv.notify_all();
+		if (_failed) {
+			_work_cv.notify_all();
+			return;
+		}
+	}
+}
+
+bool obsffmpeg::parallel_encoder::encode(AVCodecContext* context, AVFrame* frame, std::deque<AVPacket*>& packets)
+{
+	bool sent = false;
+	while (true) {
+		if (!sent) {
+			int res = avcodec_send_frame(context, frame);
+			if ((res == 0) || (res == AVERROR_EOF)) {
+				sent = true;
+			} else if (res != AVERROR(EAGAIN)) {
+				PLOG_ERROR("[%s] Failed to encode frame: %s (%ld).", context->codec->name,
+				           ffmpeg::tools::get_error_description(res), res);
+				return false;
+			}
+		}
+
+		size_t before = packets.size();
+		int    res    = 0;
+		while (res == 0) {
+			AVPacket* pkt = _packet_pool->acquire_packet();
+			res           = avcodec_receive_packet(context, pkt);
+			if (res == 0) {
+				packets.push_back(pkt);
+			} else {
+				_packet_pool->release_packet(pkt);
+			}
+		}
+		if (res == AVERROR_EOF)
+			return true;
+		if (res != AVERROR(EAGAIN)) {
+			PLOG_ERROR("[%s] Failed to receive packet: %s (%ld).", context->codec->name,
+			           ffmpeg::tools::get_error_description(res), res);
+			return false;
+		}
+
+		// A sent frame only needs what is ready right away, a drained context ends with EOF above.
+		if (sent)
+			return true;
+		if (packets.size() == before) {
+			PLOG_ERROR("[%s] Both send and recieve returned EAGAIN, encoder is broken.",
+			           context->codec->name);
+			return false;
+		}
+	}
+}
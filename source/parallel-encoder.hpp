@@ -0,0 +1,133 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ffmpeg/avpacket-pool.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#pragma warning(pop)
+}
+
+namespace obsffmpeg {
+	// Encodes independent parts of a stream on several codec contexts at once.
+	// A segment is a run of frames that references nothing outside of itself, which is a single frame for
+	// intra-only codecs. Segments are handed to the lanes in turn, each lane has its own context and thread, and
+	// the packets come back out in the order the segments were started.
+	class parallel_encoder {
+		public:
+		// Returns a new, opened codec context, or throws.
+		typedef std::function<AVCodecContext*()> context_factory;
+
+		private:
+		struct segment {
+			std::deque<std::shared_ptr<AVFrame>> frames;
+			std::deque<AVPacket*>                packets;
+			size_t                               count  = 0;
+			bool                                 closed = false;
+			bool                                 done   = false;
+		};
+
+		struct lane {
+			AVCodecContext*                      context = nullptr;
+			std::thread                          thread;
+			std::deque<std::shared_ptr<segment>> segments;
+		};
+
+		context_factory        _factory;
+		ffmpeg::avpacket_pool* _packet_pool;
+		size_t                 _segment_frames;
+		bool                   _restart;
+
+		std::vector<std::unique_ptr<lane>> _lanes;
+		size_t                             _next_lane;
+
+		std::mutex              _lock;
+		std::condition_variable _work_cv;
+		std::condition_variable _done_cv;
+		bool                    _stop;
+		bool                    _failed;
+
+		// Segments in the order they were started, the front one is the next to return packets from.
+		std::deque<std::shared_ptr<segment>> _order;
+		std::shared_ptr<segment>             _current;
+
+		uint64_t                 _segments;
+		std::chrono::nanoseconds _wait_time;
+
+		void lane_main(lane* ln);
+
+		// Sends the frame, or drains the context to the end if there is none, and collects all packets it has.
+		bool encode(AVCodecContext* context, AVFrame* frame, std::deque<AVPacket*>& packets);
+
+		public:
+		parallel_encoder();
+		~parallel_encoder();
+
+		// Segments are closed after segment_frames frames. With restart, every lane is drained and replaced by
+		// a new context after each segment, which is what makes long-GOP segments independent of each other.
+		void initialize(size_t lanes, size_t segment_frames, bool restart, context_factory factory,
+		                ffmpeg::avpacket_pool* packet_pool);
+
+		// Stops all lanes, packets that were not returned yet are released.
+		void finalize();
+
+		bool is_valid();
+
+		bool has_failed();
+
+		size_t get_lane_count();
+
+		// Most frames that can be waiting in or for the lanes at once.
+		size_t get_frame_capacity();
+
+		// Adds a frame to the current segment. Starting a new segment waits until there are no more than one
+		// per lane in flight, which bounds both the reordering and the latency.
+		bool push(std::shared_ptr<AVFrame> frame);
+
+		// Ends the current segment early, the next frame starts a new one.
+		void close_segment();
+
+		// Takes the next packet in stream order, if it is ready.
+		bool pop(AVPacket*& packet);
+
+		uint64_t get_segment_count();
+
+		// Segments that have not returned all of their packets yet.
+		size_t get_pending_segments();
+
+		// Time spent in push() waiting for a lane to finish.
+		std::chrono::nanoseconds get_wait_time();
+	};
+} // namespace obsffmpeg
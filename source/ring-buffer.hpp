@@ -0,0 +1,197 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace obsffmpeg {
+	// Bounded single-producer single-consumer ring.
+	// Exactly one thread may call push(), and exactly one (other) thread may call pop().
+	template<typename T>
+	class spsc_ring {
+		std::vector<T> _buffer;
+		size_t         _mask;
+
+		// Consumer and producer positions live on separate cache lines to avoid false sharing.
+		alignas(64) std::atomic<size_t> _head;
+		alignas(64) std::atomic<size_t> _tail;
+
+		public:
+		spsc_ring(size_t capacity) : _mask(0), _head(0), _tail(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+				size <<= 1;
+			_buffer.resize(size);
+			_mask = size - 1;
+		}
+
+		// Moves the value into the ring, leaves it untouched if the ring is full.
+		bool push(T& value)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if ((tail - _head.load(std::memory_order_acquire)) > _mask)
+				return false;
+
+			_buffer[tail & _mask] = std::move(value);
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T& value)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire))
+				return false;
+
+			value                 = std::move(_buffer[head & _mask]);
+			_buffer[head & _mask] = T();
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		size_t size() const
+		{
+			return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		bool full() const
+		{
+			return size() > _mask;
+		}
+
+		size_t capacity() const
+		{
+			return _mask + 1;
+		}
+	};
+
+	// Bounded multi-producer multi-consumer ring.
+	// Every cell carries a sequence number which tells producers and consumers whose turn it is, so neither side
+	// ever takes a lock. Based on the bounded MPMC queue by Dmitry Vyukov.
+	template<typename T>
+	class mpmc_ring {
+		struct cell {
+			std::atomic<size_t> sequence;
+			T                   value;
+		};
+
+		std::unique_ptr<cell[]> _buffer;
+		size_t                  _mask;
+
+		alignas(64) std::atomic<size_t> _head;
+		alignas(64) std::atomic<size_t> _tail;
+
+		public:
+		mpmc_ring(size_t capacity) : _mask(0), _head(0), _tail(0)
+		{
+			size_t size = 2;
+			while (size < capacity)
+				size <<= 1;
+			_buffer = std::unique_ptr<cell[]>(new cell[size]);
+			_mask   = size - 1;
+			for (size_t idx = 0; idx < size; idx++) {
+				_buffer[idx].sequence.store(idx, std::memory_order_relaxed);
+			}
+		}
+
+		// Moves the value into the ring, leaves it untouched if the ring is full.
+		bool push(T& value)
+		{
+			cell*  c;
+			size_t pos = _tail.load(std::memory_order_relaxed);
+			while (true) {
+				c             = &_buffer[pos & _mask];
+				size_t   seq  = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+				if (diff == 0) {
+					if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = _tail.load(std::memory_order_relaxed);
+				}
+			}
+
+			c->value = std::move(value);
+			c->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T& value)
+		{
+			cell*  c;
+			size_t pos = _head.load(std::memory_order_relaxed);
+			while (true) {
+				c             = &_buffer[pos & _mask];
+				size_t   seq  = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+				if (diff == 0) {
+					if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = _head.load(std::memory_order_relaxed);
+				}
+			}
+
+			value    = std::move(c->value);
+			c->value = T();
+			c->sequence.store(pos + _mask + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only a snapshot, other threads may change it at any time.
+		size_t size() const
+		{
+			size_t head = _head.load(std::memory_order_acquire);
+			size_t tail = _tail.load(std::memory_order_acquire);
+			return (tail > head) ? (tail - head) : 0;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		bool full() const
+		{
+			return size() > _mask;
+		}
+
+		size_t capacity() const
+		{
+			return _mask + 1;
+		}
+	};
+} // namespace obsffmpeg
@@ -0,0 +1,71 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace obsffmpeg {
+	// OBS hands every encoder of a video frame its input within a fraction of the frame interval, so anything
+	// shared for a video frame that is older than three quarters of it belongs to an earlier one.
+	inline std::chrono::nanoseconds get_shared_frame_max_age(uint32_t fps_num, uint32_t fps_den)
+	{
+		constexpr int64_t  max_age_num = 3;
+		constexpr uint32_t max_age_den = 4;
+		return std::chrono::nanoseconds(1000000000LL * fps_den * max_age_num
+		                                / (std::max<uint32_t>(fps_num, 1) * max_age_den));
+	}
+
+	// Objects shared by key across the whole process, kept alive only by the ones using them.
+	template<typename Key, typename T>
+	class shared_registry {
+		std::mutex                      _lock;
+		std::map<Key, std::weak_ptr<T>> _objects;
+
+		public:
+		// The object registered under the key, or a new one from create() if there is none or its last user is
+		// gone. Objects whose last user is gone are forgotten along the way.
+		template<typename Create>
+		std::shared_ptr<T> acquire(const Key& key, Create create)
+		{
+			std::unique_lock<std::mutex> ulock(_lock);
+			for (auto it = _objects.begin(); it != _objects.end();) {
+				if (it->second.expired()) {
+					it = _objects.erase(it);
+				} else {
+					it++;
+				}
+			}
+
+			std::shared_ptr<T> object = _objects[key].lock();
+			if (!object) {
+				object        = create();
+				_objects[key] = object;
+			}
+			return object;
+		}
+	};
+} // namespace obsffmpeg
@@ -0,0 +1,108 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "threadpool.hpp"
+
+obsffmpeg::threadpool::threadpool(size_t threads)
+    : _stop(false), _generation(0), _active(0), _task(nullptr), _count(0), _next(0)
+{
+	for (size_t idx = 1; idx < threads; idx++) {
+		_workers.emplace_back([this]() { worker_main(); });
+	}
+}
+
+obsffmpeg::threadpool::~threadpool()
+{
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_stop = true;
+	}
+	_work_cv.notify_all();
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+}
+
+size_t obsffmpeg::threadpool::size()
+{
+	return _workers.size() + 1;
+}
+
+void obsffmpeg::threadpool::worker_main()
+{
+	uint64_t generation = 0;
+	while (true) {
+		std::function<void(size_t)> const* task;
+		size_t                             count;
+		{
+			std::unique_lock<std::mutex> ulock(_lock);
+			_work_cv.wait(ulock, [this, generation]() { return _stop || (_generation != generation); });
+			if (_stop)
+				return;
+			generation = _generation;
+			task       = _task;
+			count      = _count;
+		}
+
+		execute(*task, count);
+
+		{
+			std::unique_lock<std::mutex> ulock(_lock);
+			if (--_active == 0)
+				_done_cv.notify_all();
+		}
+	}
+}
+
+void obsffmpeg::threadpool::execute(std::function<void(size_t)> const& task, size_t count)
+{
+	for (size_t idx = _next++; idx < count; idx = _next++) {
+		task(idx);
+	}
+}
+
+void obsffmpeg::threadpool::parallel_for(size_t count, std::function<void(size_t)> const& task)
+{
+	if ((count <= 1) || _workers.empty()) {
+		for (size_t idx = 0; idx < count; idx++) {
+			task(idx);
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> clock(_call_lock);
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		_task   = &task;
+		_count  = count;
+		_next   = 0;
+		_active = _workers.size();
+		_generation++;
+	}
+	_work_cv.notify_all();
+
+	execute(task, count);
+
+	std::unique_lock<std::mutex> ulock(_lock);
+	_done_cv.wait(ulock, [this]() { return _active == 0; });
+	_task = nullptr;
+}
@@ -0,0 +1,61 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace obsffmpeg {
+	// Fixed size pool of threads for splitting the work on a single frame into independent parts.
+	// The calling thread always takes part in the work, so a pool of size 1 has no extra threads.
+	class threadpool {
+		std::vector<std::thread> _workers;
+		std::mutex               _call_lock;
+
+		std::mutex              _lock;
+		std::condition_variable _work_cv;
+		std::condition_variable _done_cv;
+		bool                    _stop;
+		uint64_t                _generation;
+		size_t                  _active;
+
+		std::function<void(size_t)> const* _task;
+		size_t                             _count;
+		std::atomic<size_t>                _next;
+
+		void worker_main();
+		void execute(std::function<void(size_t)> const& task, size_t count);
+
+		public:
+		threadpool(size_t threads);
+		~threadpool();
+
+		size_t size();
+
+		// Calls task(0) to task(count - 1) spread over all threads and returns once every call has completed.
+		void parallel_for(size_t count, std::function<void(size_t)> const& task);
+	};
+} // namespace obsffmpeg
@@ -58,11 +58,17 @@ void obsffmpeg::ui::prores_aw_handler::override_colorformat(AVPixelFormat& targe
 			}
 		}
 	}
+
+	// 4444 profiles can also carry an alpha channel.
+	if ((target_format == AV_PIX_FMT_YUV444P10) && obs_data_get_bool(settings, P_PRORES_ALPHA)) {
+		target_format = AV_PIX_FMT_YUVA444P10;
+	}
 }
 
 void obsffmpeg::ui::prores_aw_handler::get_defaults(obs_data_t* settings, const AVCodec*, AVCodecContext*, bool)
 {
 	obs_data_set_default_int(settings, P_PRORES_PROFILE, 0);
+	obs_data_set_default_bool(settings, P_PRORES_ALPHA, false);
 }
 
 void obsffmpeg::ui::prores_aw_handler::get_properties(obs_properties_t* props, const AVCodec* codec,
@@ -95,8 +101,12 @@ void obsffmpeg::ui::prores_aw_handler::get_properties(obs_properties_t* props, c
 				obs_property_list_add_int(p, ptr->name, ptr->profile);
 			}
 		}
+
+		p = obs_properties_add_bool(props, P_PRORES_ALPHA, TRANSLATE(P_PRORES_ALPHA));
+		obs_property_set_long_description(p, TRANSLATE(DESC(P_PRORES_ALPHA)));
 	} else {
 		obs_property_set_enabled(obs_properties_get(props, P_PRORES_PROFILE), false);
+		obs_property_set_enabled(obs_properties_get(props, P_PRORES_ALPHA), false);
 	}
 }
 
@@ -111,6 +121,8 @@ void obsffmpeg::ui::prores_aw_handler::log_options(obs_data_t* settings, const A
 		if (ptr->profile == static_cast<int>(obs_data_get_int(settings, P_PRORES_PROFILE)))
 			PLOG_INFO("[%s]   Profile: %s", codec->name, ptr->name);
 	}
+	if (obs_data_get_bool(settings, P_PRORES_ALPHA))
+		PLOG_INFO("[%s]   Alpha: Enabled", codec->name);
 }
 
 void obsffmpeg::ui::prores_aw_handler::process_avpacket(AVPacket& packet, const AVCodec*, AVCodecContext*)
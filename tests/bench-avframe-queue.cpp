@@ -0,0 +1,135 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Contention benchmark for ffmpeg::avframe_queue, against the mutex and deque it replaced.
+// Frames are handed from a number of producer threads to a number of consumer threads through one queue.
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "bench.hpp"
+#include "ffmpeg/avframe-queue.hpp"
+
+static constexpr size_t   queue_capacity = 64;
+static constexpr size_t   transfers      = 200000;
+static constexpr uint32_t frame_width    = 64;
+static constexpr uint32_t frame_height   = 64;
+
+// How avframe_queue worked before, with the missing locks in empty() and size() added.
+class locked_queue {
+	std::mutex                           _lock;
+	std::deque<std::shared_ptr<AVFrame>> _frames;
+	size_t                               _capacity;
+
+	public:
+	locked_queue(size_t capacity) : _capacity(capacity) {}
+
+	bool push(std::shared_ptr<AVFrame> frame)
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		if (_frames.size() >= _capacity)
+			return false;
+		_frames.push_back(frame);
+		return true;
+	}
+
+	std::shared_ptr<AVFrame> pop_only()
+	{
+		std::unique_lock<std::mutex> ulock(_lock);
+		if (_frames.empty())
+			return nullptr;
+		std::shared_ptr<AVFrame> frame = _frames.front();
+		_frames.pop_front();
+		return frame;
+	}
+};
+
+// Moves the given number of frames through the queue, spinning whenever it is full or empty.
+template<typename T>
+static void transfer(T& queue, std::vector<std::shared_ptr<AVFrame>> const& frames, size_t producers,
+                     size_t consumers)
+{
+	std::atomic<size_t>      popped(0);
+	std::vector<std::thread> threads;
+
+	for (size_t idx = 0; idx < producers; idx++) {
+		threads.emplace_back([&queue, &frames, idx, producers]() {
+			size_t count = transfers / producers + ((idx < (transfers % producers)) ? 1 : 0);
+			for (size_t n = 0; n < count; n++) {
+				while (!queue.push(frames[n % frames.size()]))
+					std::this_thread::yield();
+			}
+		});
+	}
+	for (size_t idx = 0; idx < consumers; idx++) {
+		threads.emplace_back([&queue, &popped]() {
+			while (popped.load(std::memory_order_relaxed) < transfers) {
+				if (queue.pop_only()) {
+					popped++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+int main(int, char*[])
+{
+	ffmpeg::avframe_queue queue(queue_capacity);
+	locked_queue          locked(queue_capacity);
+	queue.set_resolution(frame_width, frame_height);
+	queue.set_pixel_format(AV_PIX_FMT_YUV420P);
+
+	std::vector<std::shared_ptr<AVFrame>> frames;
+	for (size_t idx = 0; idx < queue_capacity; idx++) {
+		frames.push_back(queue.get_pool().get());
+	}
+
+	std::printf("%u hardware threads, %d frames per run, queue capacity %d.\n",
+	            std::thread::hardware_concurrency(), transfers, queue_capacity);
+	std::printf("%-20s %14s %14s\n", "Producers/Consumers", "mutex+deque", "mpmc_ring");
+
+	std::pair<size_t, size_t> setups[] = {{1, 1}, {2, 2}, {4, 4}, {4, 1}, {1, 4}};
+	for (auto setup : setups) {
+		double_t ms_locked = bench::measure([&]() { transfer(locked, frames, setup.first, setup.second); },
+		                                    std::chrono::milliseconds(0), 5);
+		double_t ms_queue  = bench::measure([&]() { transfer(queue, frames, setup.first, setup.second); },
+		                                    std::chrono::milliseconds(0), 5);
+		std::printf("%9zu/%-10zu %9.2f Mf/s %9.2f Mf/s\n", setup.first, setup.second,
+		            transfers / (ms_locked * 1000.0), transfers / (ms_queue * 1000.0));
+	}
+
+	// A single thread cycling frames through pop(), which also checks every frame against the format.
+	double_t ms_cycle = bench::measure([&]() {
+		for (size_t n = 0; n < transfers; n++) {
+			queue.push(queue.pop());
+		}
+	});
+	std::printf("pop() and push() on one thread: %.1f ns per frame.\n", ms_cycle * 1000000.0 / transfers);
+	return 0;
+}
@@ -0,0 +1,182 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Benchmark for convert::plane_copy against the copy_data() function it replaced, at 1080p, 1440p and 4K.
+// Both line size layouts are covered: one where source and target match and whole planes can be copied at once,
+// and one where the source has padding and every row has to be copied separately.
+
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include "bench.hpp"
+#include "convert/plane-copy.hpp"
+#include "convert/simd.hpp"
+#include "ffmpeg/avframe-pool.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#pragma warning(pop)
+}
+
+// Extra bytes per source row for the padded layout.
+static constexpr int padding = 128;
+
+// How encoder.cpp copied frames before, minus the encoder_frame wrapper.
+static void copy_data(uint8_t* const src[], const uint32_t src_linesize[], AVFrame* vframe)
+{
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(static_cast<AVPixelFormat>(vframe->format), &h_chroma_shift, &v_chroma_shift);
+
+	for (size_t idx = 0; idx < 4; idx++) {
+		if (!src[idx] || !vframe->data[idx])
+			continue;
+
+		size_t plane_height = vframe->height >> (idx ? v_chroma_shift : 0);
+
+		if (static_cast<uint32_t>(vframe->linesize[idx]) == src_linesize[idx]) {
+			std::memcpy(vframe->data[idx], src[idx], src_linesize[idx] * plane_height);
+		} else {
+			size_t ls_in  = src_linesize[idx];
+			size_t ls_out = vframe->linesize[idx];
+			size_t bytes  = ls_in < ls_out ? ls_in : ls_out;
+
+			uint8_t* to   = vframe->data[idx];
+			uint8_t* from = src[idx];
+
+			for (size_t y = 0; y < plane_height; y++) {
+				std::memcpy(to, from, bytes);
+				to += ls_out;
+				from += ls_in;
+			}
+		}
+	}
+}
+
+struct source_frame {
+	std::vector<uint8_t> memory;
+	uint8_t*             data[4];
+	uint32_t             linesize[4];
+	size_t               bytes;
+};
+
+static void allocate_source(source_frame& frame, AVPixelFormat format, int width, int height,
+                            const int dst_linesize[], size_t padding)
+{
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift, &v_chroma_shift);
+
+	size_t offsets[4] = {0};
+	frame.bytes       = 0;
+	for (int idx = 0; idx < 4; idx++) {
+		frame.linesize[idx] = 0;
+		if (idx >= av_pix_fmt_count_planes(format))
+			continue;
+
+		size_t rows         = (idx == 1 || idx == 2) ? AV_CEIL_RSHIFT(height, v_chroma_shift) : height;
+		frame.linesize[idx] = static_cast<uint32_t>(dst_linesize[idx] + padding);
+		offsets[idx]        = frame.bytes;
+		frame.bytes += frame.linesize[idx] * rows;
+	}
+
+	frame.memory.assign(frame.bytes + 64, 0x80);
+	uint8_t* base = frame.memory.data() + ((64 - (reinterpret_cast<uintptr_t>(frame.memory.data()) & 63)) & 63);
+	for (int idx = 0; idx < 4; idx++) {
+		frame.data[idx] = frame.linesize[idx] ? (base + offsets[idx]) : nullptr;
+	}
+}
+
+int main(int, char*[])
+{
+	struct resolution {
+		const char* name;
+		int         width;
+		int         height;
+	} resolutions[] = {{"1080p", 1920, 1080}, {"1440p", 2560, 1440}, {"4K", 3840, 2160}};
+	AVPixelFormat formats[] = {AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P};
+
+	std::vector<size_t> thread_counts = {1, 2, 4, std::max<size_t>(1, std::thread::hardware_concurrency())};
+	std::sort(thread_counts.begin(), thread_counts.end());
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	std::printf("Last level cache: %zu KiB, %u hardware threads.\n",
+	            obsffmpeg::convert::get_llc_size() >> 10, std::thread::hardware_concurrency());
+	std::printf("%-6s %-8s %-7s %-23s %10s", "Size", "Format", "Layout", "Kernel", "copy_data");
+	for (size_t threads : thread_counts) {
+		std::printf(" %10zu thr", threads);
+	}
+	std::printf("\n");
+
+	for (auto& res : resolutions) {
+		for (auto format : formats) {
+			ffmpeg::avframe_pool pool;
+			pool.set_resolution(static_cast<uint32_t>(res.width), static_cast<uint32_t>(res.height));
+			pool.set_pixel_format(format);
+			std::shared_ptr<AVFrame> target = pool.get();
+
+			for (size_t padding : {static_cast<size_t>(0), static_cast<size_t>(padding)}) {
+				source_frame source;
+				allocate_source(source, format, res.width, res.height, target->linesize, padding);
+
+				double_t ms_old =
+				    bench::measure([&]() { copy_data(source.data, source.linesize, target.get()); });
+
+				// Which of the two the plane copy picks on its own for this frame size.
+				obsffmpeg::convert::plane_copy copier;
+				copier.initialize(format, res.width, res.height);
+				bool streaming = copier.is_streaming();
+
+				// Once with regular stores, once with non-temporal stores.
+				for (size_t threshold : {SIZE_MAX, static_cast<size_t>(1)}) {
+					copier.set_streaming_threshold(threshold);
+					copier.initialize(format, res.width, res.height);
+					char name[32];
+					std::snprintf(name, sizeof(name), "%s%s", copier.get_kernel_name(),
+					              (copier.is_streaming() == streaming) ? " *" : "");
+					if (threshold == SIZE_MAX) {
+						std::printf("%-6s %-8s %-7s %-23s %10.3f", res.name,
+						            av_get_pix_fmt_name(format), padding ? "padded" : "same",
+						            name, ms_old);
+					} else {
+						std::printf("%-6s %-8s %-7s %-23s %10s", "", "", "", name, "");
+					}
+
+					for (size_t threads : thread_counts) {
+						auto pool_threads = std::make_shared<obsffmpeg::threadpool>(threads);
+						copier.initialize(format, res.width, res.height, pool_threads);
+						double_t ms = bench::measure([&]() {
+							copier.copy(source.data, source.linesize, target->data,
+							            target->linesize);
+						});
+						std::printf(" %7.3f (%2zu)", ms, copier.get_stripe_count());
+					}
+					std::printf("\n");
+				}
+			}
+		}
+	}
+	std::printf("Milliseconds per frame, stripes the planes were split into in parentheses.\n");
+	std::printf("Kernels marked with * are the ones picked without a threshold set.\n");
+	return 0;
+}
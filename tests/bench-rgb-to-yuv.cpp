@@ -0,0 +1,130 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Benchmark for the RGB to YUV conversion kernels, against the swscale path they replace. Both run once on the
+// calling thread and once split into bands on all hardware threads, like the encoder does. swscale can't split
+// conversions to 4:2:0 into bands, as the chroma subsampling of source and target differs.
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include "bench.hpp"
+#include "convert/converter.hpp"
+#include "convert/simd.hpp"
+#include "ffmpeg/avframe-pool.hpp"
+#include "ffmpeg/swscale.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#pragma warning(pop)
+}
+
+using namespace obsffmpeg::convert;
+
+static std::shared_ptr<AVFrame> get_frame(ffmpeg::avframe_pool& pool, AVPixelFormat format, int width, int height)
+{
+	pool.set_resolution(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	pool.set_pixel_format(format);
+	return pool.get();
+}
+
+// Prints one row of the table for a conversion, a dash where it is not available.
+static void run(const char* size, int width, int height, AVPixelFormat source_format, AVPixelFormat target_format,
+                std::shared_ptr<obsffmpeg::threadpool> pool_threads)
+{
+	ffmpeg::avframe_pool     source_pool, target_pool;
+	std::shared_ptr<AVFrame> source = get_frame(source_pool, source_format, width, height);
+	std::shared_ptr<AVFrame> target = get_frame(target_pool, target_format, width, height);
+	std::memset(source->data[0], 0x80, static_cast<size_t>(source->linesize[0]) * height);
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%s to %s", av_get_pix_fmt_name(source_format),
+	              av_get_pix_fmt_name(target_format));
+	std::printf("%-6s %-18s", size, name);
+
+	// swscale, as set up by the encoder for the same conversion.
+	for (size_t bands : {static_cast<size_t>(1), pool_threads->size()}) {
+		ffmpeg::swscale swscale;
+		swscale.set_source_size(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		swscale.set_source_format(source_format);
+		swscale.set_source_color(false, AVCOL_SPC_BT709);
+		swscale.set_target_size(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		swscale.set_target_format(target_format);
+		swscale.set_target_color(false, AVCOL_SPC_BT709);
+		swscale.set_threads(pool_threads);
+		swscale.set_band_count(static_cast<uint32_t>(bands));
+		if (!swscale.initialize(SWS_POINT) || ((bands > 1) && (swscale.get_band_count() <= 1))) {
+			std::printf(" %10s", "-");
+			continue;
+		}
+		double_t ms = bench::measure([&]() {
+			swscale.convert(source->data, source->linesize, 0, height, target->data, target->linesize);
+		});
+		std::printf(" %10.3f", ms);
+	}
+
+	// The converter picks the kernel for the best instruction set, once without threads and once in bands.
+	const char* kernel = "-";
+	for (auto threads : {std::shared_ptr<obsffmpeg::threadpool>(), pool_threads}) {
+		converter convert;
+		if (!convert.initialize(source_format, false, AVCOL_SPC_BT709, target_format, false, AVCOL_SPC_BT709,
+		                        width, height, threads)) {
+			std::printf(" %10s", "-");
+			continue;
+		}
+		kernel      = convert.get_name();
+		double_t ms = bench::measure(
+		    [&]() { convert.convert(source->data, source->linesize, target->data, target->linesize); });
+		std::printf(" %10.3f", ms);
+	}
+	std::printf("  %s\n", kernel);
+}
+
+int main(int, char*[])
+{
+	struct resolution {
+		const char* name;
+		int         width;
+		int         height;
+	} resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+	AVPixelFormat sources[] = {AV_PIX_FMT_RGBA, AV_PIX_FMT_BGRA, AV_PIX_FMT_BGR0};
+	AVPixelFormat targets[] = {AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV444P};
+
+	size_t threads      = std::max<size_t>(1, std::thread::hardware_concurrency());
+	auto   pool_threads = std::make_shared<obsffmpeg::threadpool>(threads);
+
+	std::printf("Instruction set: %s, %zu hardware threads.\n", get_simd_level_name(get_simd_level()), threads);
+	std::printf("%-6s %-18s %10s %10s %10s %10s  %s\n", "Size", "Conversion", "swscale", "(bands)", "converter",
+	            "(bands)", "Kernel");
+	for (auto& res : resolutions) {
+		for (auto source_format : sources) {
+			for (auto target_format : targets) {
+				run(res.name, res.width, res.height, source_format, target_format, pool_threads);
+			}
+		}
+	}
+	std::printf("Milliseconds per frame. (bands) columns are split over all hardware threads.\n");
+	return 0;
+}
@@ -0,0 +1,153 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Benchmark for the 8-bit to 10-bit widening kernels used for ProRes, against the swscale path they replaced.
+// swscale runs with the flags the encoder uses, once on the calling thread and once split into bands like the
+// encoder does. Every kernel level runs on one thread, the converter runs on all hardware threads.
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include "bench.hpp"
+#include "convert/converter.hpp"
+#include "convert/simd.hpp"
+#include "ffmpeg/avframe-pool.hpp"
+#include "ffmpeg/swscale.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#pragma warning(pop)
+}
+
+using namespace obsffmpeg::convert;
+
+static std::shared_ptr<AVFrame> get_frame(ffmpeg::avframe_pool& pool, AVPixelFormat format, int width, int height)
+{
+	pool.set_resolution(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	pool.set_pixel_format(format);
+	return pool.get();
+}
+
+int main(int, char*[])
+{
+	struct resolution {
+		const char* name;
+		int         width;
+		int         height;
+	} resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+	simd_level levels[] = {simd_level::NONE, simd_level::SSE2, simd_level::AVX2};
+
+	std::vector<kernel_info> kernels;
+	register_widen_kernels(kernels);
+
+	size_t threads      = std::max<size_t>(1, std::thread::hardware_concurrency());
+	auto   pool_threads = std::make_shared<obsffmpeg::threadpool>(threads);
+
+	std::printf("Instruction set: %s, %zu hardware threads.\n", get_simd_level_name(get_simd_level()), threads);
+	std::printf("%-6s %-24s %10s %10s", "Size", "Conversion", "swscale", "(bands)");
+	for (auto level : levels) {
+		std::printf(" %10s", (level == simd_level::NONE) ? "C" : get_simd_level_name(level));
+	}
+	std::printf(" %10s\n", "(bands)");
+
+	for (auto& res : resolutions) {
+		for (auto const& info : kernels) {
+			if (info.level != simd_level::NONE)
+				continue;
+
+			ffmpeg::avframe_pool     source_pool, target_pool;
+			std::shared_ptr<AVFrame> source = get_frame(source_pool, info.source, res.width, res.height);
+			std::shared_ptr<AVFrame> target = get_frame(target_pool, info.target, res.width, res.height);
+			int h_chroma_shift, v_chroma_shift;
+			av_pix_fmt_get_chroma_sub_sample(info.source, &h_chroma_shift, &v_chroma_shift);
+			for (int idx = 0; idx < av_pix_fmt_count_planes(info.source); idx++) {
+				int rows = idx ? AV_CEIL_RSHIFT(res.height, v_chroma_shift) : res.height;
+				std::memset(source->data[idx], 0x80, static_cast<size_t>(source->linesize[idx]) * rows);
+			}
+
+			char name[32];
+			std::snprintf(name, sizeof(name), "%s to %s", av_get_pix_fmt_name(info.source),
+			              av_get_pix_fmt_name(info.target));
+			std::printf("%-6s %-24s", res.name, name);
+
+			// swscale, as set up by the encoder for the same conversion.
+			for (size_t bands : {static_cast<size_t>(1), threads}) {
+				auto width  = static_cast<uint32_t>(res.width);
+				auto height = static_cast<uint32_t>(res.height);
+
+				ffmpeg::swscale swscale;
+				swscale.set_source_size(width, height);
+				swscale.set_source_format(info.source);
+				swscale.set_source_color(false, AVCOL_SPC_BT709);
+				swscale.set_target_size(width, height);
+				swscale.set_target_format(info.target);
+				swscale.set_target_color(false, AVCOL_SPC_BT709);
+				swscale.set_threads(pool_threads);
+				swscale.set_band_count(static_cast<uint32_t>(bands));
+				if (!swscale.initialize(SWS_POINT)) {
+					std::printf(" %10s", "-");
+					continue;
+				}
+				double_t ms = bench::measure([&]() {
+					swscale.convert(source->data, source->linesize, 0, res.height, target->data,
+					                target->linesize);
+				});
+				std::printf(" %10.3f", ms);
+			}
+
+			for (auto level : levels) {
+				const kernel_info* kernel = nullptr;
+				for (auto const& other : kernels) {
+					if ((other.source == info.source) && (other.target == info.target)
+					    && (other.level == level))
+						kernel = &other;
+				}
+				if (!kernel || (level > get_simd_level())) {
+					std::printf(" %10s", "-");
+					continue;
+				}
+
+				kernel_context ctx = {};
+				ctx.width          = res.width;
+				ctx.height         = res.height;
+				kernel->prepare(ctx, false, AVCOL_SPC_BT709, false, AVCOL_SPC_BT709);
+				double_t ms = bench::measure([&]() {
+					kernel->kernel(ctx, source->data, source->linesize, target->data,
+					               target->linesize, 0, res.height);
+				});
+				std::printf(" %10.3f", ms);
+			}
+
+			converter convert;
+			convert.initialize(info.source, false, AVCOL_SPC_BT709, info.target, false, AVCOL_SPC_BT709,
+			                   res.width, res.height, pool_threads);
+			double_t ms = bench::measure(
+			    [&]() { convert.convert(source->data, source->linesize, target->data, target->linesize); });
+			std::printf(" %10.3f\n", ms);
+		}
+	}
+	std::printf("Milliseconds per frame. (bands) columns are split over all hardware threads.\n");
+	return 0;
+}
@@ -0,0 +1,62 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace bench {
+	// Calls the function until it ran for at least the given time, and returns the fastest of several such
+	// rounds in milliseconds per call. The fastest round is the one least disturbed by the rest of the system.
+	template<typename T>
+	double_t measure(T&& function, std::chrono::milliseconds round_time = std::chrono::milliseconds(200),
+	                 size_t rounds = 5)
+	{
+		function(); // Warm up caches and allocations.
+
+		double_t best = 0;
+		for (size_t round = 0; round < rounds; round++) {
+			size_t calls = 0;
+			auto   begin = std::chrono::high_resolution_clock::now();
+			auto   end   = begin;
+			do {
+				function();
+				calls++;
+				end = std::chrono::high_resolution_clock::now();
+			} while ((end - begin) < round_time);
+
+			double_t ms = std::chrono::duration<double_t, std::milli>(end - begin).count() / calls;
+			best        = (round == 0) ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	// Rate in MiB/s for a call that takes the given time and touches the given number of bytes.
+	inline double_t throughput(double_t ms, size_t bytes)
+	{
+		return (static_cast<double_t>(bytes) / (1024.0 * 1024.0)) / (ms / 1000.0);
+	}
+} // namespace bench
@@ -0,0 +1,361 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Checks every SIMD conversion kernel against the C kernel for the same conversion. The output has to be identical
+// for odd and even sizes and for any split of the frame into bands, as the converter picks kernels by CPU.
+// The C RGB to YUV kernels are also compared with swscale for 4:4:4 targets, where the only difference allowed is
+// rounding. 4:2:0 targets are not compared, swscale does not filter chroma with a 2x2 box.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "convert/converter.hpp"
+#include "convert/kernel.hpp"
+#include "convert/simd.hpp"
+#include "ffmpeg/swscale.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#pragma warning(pop)
+}
+
+using namespace obsffmpeg::convert;
+
+// Extra bytes per row, filled with noise on the source side so reading past the width shows up as a mismatch.
+static constexpr int padding = 64;
+
+// Largest difference to swscale, in steps of the target depth.
+static constexpr int swscale_tolerance = 1;
+
+struct image {
+	std::vector<uint8_t> memory;
+	uint8_t*             data[4];
+	int                  linesize[4];
+	int                  rows[4];
+	int                  bytes[4];
+	AVPixelFormat        format;
+	int                  width;
+	int                  height;
+};
+
+static uint32_t random_state = 0x12345678;
+
+static uint8_t random_byte()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return static_cast<uint8_t>(random_state >> 24);
+}
+
+static void allocate_image(image& frame, AVPixelFormat format, int width, int height)
+{
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift, &v_chroma_shift);
+
+	frame.format = format;
+	frame.width  = width;
+	frame.height = height;
+
+	size_t offsets[4] = {0};
+	size_t total      = 0;
+	int    planes     = av_pix_fmt_count_planes(format);
+	for (int idx = 0; idx < 4; idx++) {
+		frame.linesize[idx] = 0;
+		frame.rows[idx]     = 0;
+		frame.bytes[idx]    = 0;
+		if (idx >= planes)
+			continue;
+
+		frame.bytes[idx]    = av_image_get_linesize(format, width, idx);
+		frame.linesize[idx] = (frame.bytes[idx] + padding + 63) & ~63;
+		frame.rows[idx]     = (idx == 1 || idx == 2) ? AV_CEIL_RSHIFT(height, v_chroma_shift) : height;
+		offsets[idx]        = total;
+		total += static_cast<size_t>(frame.linesize[idx]) * frame.rows[idx];
+	}
+
+	frame.memory.resize(total + 64);
+	uint8_t* base = frame.memory.data() + ((64 - (reinterpret_cast<uintptr_t>(frame.memory.data()) & 63)) & 63);
+	for (int idx = 0; idx < 4; idx++) {
+		frame.data[idx] = frame.linesize[idx] ? (base + offsets[idx]) : nullptr;
+	}
+}
+
+static void fill_random(image& frame)
+{
+	for (auto& v : frame.memory) {
+		v = random_byte();
+	}
+}
+
+static void fill_constant(image& frame, uint8_t value)
+{
+	std::fill(frame.memory.begin(), frame.memory.end(), value);
+}
+
+// Compares the visible part of every plane, returns false and prints the first difference if there is one.
+static bool compare_exact(image const& expected, image const& actual, const char* what)
+{
+	for (int idx = 0; idx < 4; idx++) {
+		for (int y = 0; y < expected.rows[idx]; y++) {
+			const uint8_t* a = expected.data[idx] + static_cast<ptrdiff_t>(expected.linesize[idx]) * y;
+			const uint8_t* b = actual.data[idx] + static_cast<ptrdiff_t>(actual.linesize[idx]) * y;
+			if (std::memcmp(a, b, static_cast<size_t>(expected.bytes[idx])) == 0)
+				continue;
+
+			int x = 0;
+			while (a[x] == b[x])
+				x++;
+			std::printf("  FAIL %s, %dx%d: plane %d, row %d, byte %d is 0x%02X, not 0x%02X\n", what,
+			            expected.width, expected.height, idx, y, x, b[x], a[x]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool compare_tolerance(image const& expected, image const& actual, int depth, int tolerance,
+                              const char* what)
+{
+	for (int idx = 0; idx < 4; idx++) {
+		for (int y = 0; y < expected.rows[idx]; y++) {
+			const uint8_t* a = expected.data[idx] + static_cast<ptrdiff_t>(expected.linesize[idx]) * y;
+			const uint8_t* b = actual.data[idx] + static_cast<ptrdiff_t>(actual.linesize[idx]) * y;
+			for (int x = 0; x < expected.bytes[idx]; x += (depth > 8) ? 2 : 1) {
+				int va = a[x], vb = b[x];
+				if (depth > 8) {
+					va |= a[x + 1] << 8;
+					vb |= b[x + 1] << 8;
+				}
+				int difference = (va > vb) ? (va - vb) : (vb - va);
+				if (difference > tolerance) {
+					int sample = (depth > 8) ? (x / 2) : x;
+					std::printf("  FAIL %s, %dx%d: plane %d, row %d, sample %d is %d, not %d\n",
+					            what, expected.width, expected.height, idx, y, sample, vb, va);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static void run_kernel(kernel_info const& info, kernel_context const& ctx, image const& source, image& target,
+                       int band_rows)
+{
+	if (band_rows <= 0) {
+		info.kernel(ctx, source.data, source.linesize, target.data, target.linesize, 0, ctx.height);
+		return;
+	}
+
+	int rows = (band_rows + info.row_alignment - 1) / info.row_alignment * info.row_alignment;
+	for (int row = 0; row < ctx.height; row += rows) {
+		info.kernel(ctx, source.data, source.linesize, target.data, target.linesize, row,
+		            std::min(row + rows, ctx.height));
+	}
+}
+
+struct color {
+	bool         source_full_range;
+	AVColorSpace source_colorspace;
+	bool         target_full_range;
+	AVColorSpace target_colorspace;
+};
+
+static bool prepare(kernel_info const& info, color const& c, int width, int height, kernel_context& ctx)
+{
+	ctx            = {};
+	ctx.width      = width;
+	ctx.height     = height;
+	ctx.full_range = c.target_full_range;
+	if (info.prepare)
+		return info.prepare(ctx, c.source_full_range, c.source_colorspace, c.target_full_range,
+		                    c.target_colorspace);
+	return (c.source_full_range == c.target_full_range) && (c.source_colorspace == c.target_colorspace);
+}
+
+static const int sizes[][2] = {
+    {1, 1},   {2, 2},   {3, 3},   {7, 5},   {15, 3},  {16, 2},  {17, 7},   {31, 9},   {32, 4},
+    {33, 17}, {63, 11}, {64, 8},  {65, 13}, {95, 3},  {127, 5}, {129, 33}, {255, 7},  {321, 65},
+};
+
+static const AVColorSpace colorspaces[] = {AVCOL_SPC_BT709, AVCOL_SPC_SMPTE170M};
+
+static std::vector<color> get_colors()
+{
+	std::vector<color> colors;
+	for (auto space : colorspaces) {
+		for (int range = 0; range < 4; range++) {
+			colors.push_back({(range & 1) != 0, space, (range & 2) != 0, space});
+		}
+	}
+	return colors;
+}
+
+static size_t test_simd(std::vector<kernel_info> const& kernels, simd_level level)
+{
+	size_t failures = 0;
+	for (auto const& info : kernels) {
+		if ((info.level == simd_level::NONE) || (info.level > level))
+			continue;
+
+		const kernel_info* reference = nullptr;
+		for (auto const& other : kernels) {
+			if ((other.source == info.source) && (other.target == info.target)
+			    && (other.level == simd_level::NONE))
+				reference = &other;
+		}
+		if (!reference) {
+			std::printf("  FAIL %s: there is no C kernel to compare with\n", info.name);
+			failures++;
+			continue;
+		}
+
+		bool passed = true;
+		for (auto const& c : get_colors()) {
+			for (auto const& size : sizes) {
+				kernel_context expected_ctx, actual_ctx;
+				bool           supported = prepare(*reference, c, size[0], size[1], expected_ctx);
+				if (prepare(info, c, size[0], size[1], actual_ctx) != supported) {
+					std::printf("  FAIL %s: supports different color conversions\n", info.name);
+					passed = false;
+					break;
+				}
+				if (!supported)
+					continue;
+
+				image source, expected, actual, banded;
+				allocate_image(source, info.source, size[0], size[1]);
+				allocate_image(expected, info.target, size[0], size[1]);
+				allocate_image(actual, info.target, size[0], size[1]);
+				allocate_image(banded, info.target, size[0], size[1]);
+				fill_random(source);
+				fill_constant(expected, 0xCD);
+				fill_constant(actual, 0xCD);
+				fill_constant(banded, 0xCD);
+
+				run_kernel(*reference, expected_ctx, source, expected, 0);
+				run_kernel(info, actual_ctx, source, actual, 0);
+				run_kernel(info, actual_ctx, source, banded, 3);
+				if (!compare_exact(expected, actual, info.name)
+				    || !compare_exact(expected, banded, info.name)) {
+					passed = false;
+					break;
+				}
+			}
+			if (!passed)
+				break;
+		}
+
+		std::printf("%-4s %s\n", passed ? "OK" : "FAIL", info.name);
+		if (!passed)
+			failures++;
+	}
+	return failures;
+}
+
+static size_t test_swscale(std::vector<kernel_info> const& kernels)
+{
+	size_t failures = 0;
+	for (auto const& info : kernels) {
+		if ((info.level != simd_level::NONE)
+		    || ((info.target != AV_PIX_FMT_YUV444P) && (info.target != AV_PIX_FMT_YUVA444P10)))
+			continue;
+
+		const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(info.source);
+		if (!desc || !(desc->flags & AV_PIX_FMT_FLAG_RGB))
+			continue;
+		int depth = av_pix_fmt_desc_get(info.target)->comp[0].depth;
+
+		bool passed = true;
+		for (auto const& c : get_colors()) {
+			if (!c.source_full_range)
+				continue;
+
+			for (auto const& size : sizes) {
+				kernel_context ctx;
+				if (!prepare(info, c, size[0], size[1], ctx))
+					continue;
+
+				image source, expected, actual;
+				allocate_image(source, info.source, size[0], size[1]);
+				allocate_image(expected, info.target, size[0], size[1]);
+				allocate_image(actual, info.target, size[0], size[1]);
+				fill_random(source);
+
+				ffmpeg::swscale swscale;
+				swscale.set_source_size(static_cast<uint32_t>(size[0]), static_cast<uint32_t>(size[1]));
+				swscale.set_source_format(info.source);
+				swscale.set_source_color(c.source_full_range, c.source_colorspace);
+				swscale.set_target_size(static_cast<uint32_t>(size[0]), static_cast<uint32_t>(size[1]));
+				swscale.set_target_format(info.target);
+				swscale.set_target_color(c.target_full_range, c.target_colorspace);
+				if (!swscale.initialize(SWS_POINT | SWS_ACCURATE_RND | SWS_BITEXACT)) {
+					std::printf("  FAIL %s: swscale does not support this conversion\n", info.name);
+					passed = false;
+					break;
+				}
+				swscale.convert(source.data, source.linesize, 0, size[1], expected.data,
+				                expected.linesize);
+				run_kernel(info, ctx, source, actual, 0);
+
+				if (!compare_tolerance(expected, actual, depth, swscale_tolerance, info.name)) {
+					passed = false;
+					break;
+				}
+			}
+			if (!passed)
+				break;
+		}
+
+		std::printf("%-4s %s against swscale\n", passed ? "OK" : "FAIL", info.name);
+		if (!passed)
+			failures++;
+	}
+	return failures;
+}
+
+int main(int, char*[])
+{
+	std::vector<kernel_info> kernels;
+	register_repack_kernels(kernels);
+	register_rgb_kernels(kernels);
+	register_chroma_kernels(kernels);
+	register_widen_kernels(kernels);
+
+	simd_level level = get_simd_level();
+	std::printf("Instruction set: %s\n", get_simd_level_name(level));
+
+	size_t failures = test_simd(kernels, level);
+	failures += test_swscale(kernels);
+
+	if (failures) {
+		std::printf("%zu kernel(s) failed.\n", failures);
+		return 1;
+	}
+	return 0;
+}
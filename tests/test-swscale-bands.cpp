@@ -0,0 +1,218 @@
+// FFMPEG Video Encoder Integration for OBS Studio
+// Copyright (c) 2019 Michael Fabian Dirks <info@xaymar.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Checks that converting a frame in bands on the thread pool gives the same output as a single context, byte for
+// byte. Covers 4:2:0 and 4:2:2 conversions, including ones that dither, at heights that are not a multiple of the
+// band alignment.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "ffmpeg/swscale.hpp"
+#include "threadpool.hpp"
+
+extern "C" {
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#pragma warning(pop)
+}
+
+// Bands the frame is split into, each runs on its own thread.
+static constexpr uint32_t band_count = 4;
+
+struct image {
+	std::vector<uint8_t> planes[4];
+	uint8_t*             data[4];
+	int                  linesize[4];
+	int                  rows[4];
+	int                  bytes[4];
+};
+
+static uint32_t random_state = 0x12345678;
+
+static uint8_t random_byte()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return static_cast<uint8_t>(random_state >> 24);
+}
+
+static void allocate_image(image& frame, AVPixelFormat format, int width, int height)
+{
+	int h_chroma_shift, v_chroma_shift;
+	av_pix_fmt_get_chroma_sub_sample(format, &h_chroma_shift, &v_chroma_shift);
+
+	int planes = av_pix_fmt_count_planes(format);
+	for (int idx = 0; idx < 4; idx++) {
+		frame.data[idx]     = nullptr;
+		frame.linesize[idx] = 0;
+		frame.rows[idx]     = 0;
+		frame.bytes[idx]    = 0;
+		if (idx >= planes)
+			continue;
+
+		frame.bytes[idx]    = av_image_get_linesize(format, width, idx);
+		frame.linesize[idx] = (frame.bytes[idx] + 63) & ~63;
+		frame.rows[idx]     = (idx == 1 || idx == 2) ? AV_CEIL_RSHIFT(height, v_chroma_shift) : height;
+		frame.planes[idx].resize(static_cast<size_t>(frame.linesize[idx]) * frame.rows[idx] + 64);
+		frame.data[idx] = frame.planes[idx].data();
+	}
+}
+
+// Noise in every sample, limited to the depth of the format so that swscale sees valid input.
+static void fill_random(image& frame, AVPixelFormat format)
+{
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+	bool                      wide = desc->comp[0].depth > 8;
+	uint16_t                  mask = static_cast<uint16_t>((1u << desc->comp[0].depth) - 1);
+	for (int idx = 0; idx < 4; idx++) {
+		for (size_t pos = 0; pos < frame.planes[idx].size(); pos++) {
+			frame.planes[idx][pos] = random_byte();
+		}
+		if (!wide)
+			continue;
+
+		// Samples sit in the low bits, as in every little endian format used here.
+		auto& plane = frame.planes[idx];
+		for (size_t pos = 0; (pos + 1) < plane.size(); pos += 2) {
+			uint16_t v     = static_cast<uint16_t>(plane[pos] | (plane[pos + 1] << 8)) & mask;
+			plane[pos]     = static_cast<uint8_t>(v);
+			plane[pos + 1] = static_cast<uint8_t>(v >> 8);
+		}
+	}
+}
+
+// Compares the visible part of every plane, returns false and prints the first difference if there is one.
+static bool compare_exact(image const& expected, image const& actual, const char* what, int width, int height)
+{
+	for (int idx = 0; idx < 4; idx++) {
+		for (int y = 0; y < expected.rows[idx]; y++) {
+			const uint8_t* a = expected.data[idx] + static_cast<ptrdiff_t>(expected.linesize[idx]) * y;
+			const uint8_t* b = actual.data[idx] + static_cast<ptrdiff_t>(actual.linesize[idx]) * y;
+			if (std::memcmp(a, b, static_cast<size_t>(expected.bytes[idx])) == 0)
+				continue;
+
+			int x = 0;
+			while (a[x] == b[x])
+				x++;
+			std::printf("  FAIL %s, %dx%d: plane %d, row %d, byte %d is 0x%02X, not 0x%02X\n", what, width,
+			            height, idx, y, x, b[x], a[x]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool initialize(ffmpeg::swscale& swscale, AVPixelFormat source, AVPixelFormat target, int width, int height,
+                       int flags, std::shared_ptr<obsffmpeg::threadpool> threads, uint32_t bands)
+{
+	swscale.set_source_size(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	swscale.set_source_format(source);
+	swscale.set_source_color(false, AVCOL_SPC_BT709);
+	swscale.set_target_size(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+	swscale.set_target_format(target);
+	swscale.set_target_color(false, AVCOL_SPC_BT709);
+	swscale.set_threads(threads);
+	swscale.set_band_count(bands);
+	return swscale.initialize(flags);
+}
+
+// Converts a frame of noise with a single context and in bands, returns false if the output differs.
+static bool test_conversion(AVPixelFormat source_format, AVPixelFormat target_format, int width, int height,
+                            int flags, std::shared_ptr<obsffmpeg::threadpool> threads)
+{
+	char name[64];
+	std::snprintf(name, sizeof(name), "%s to %s (%s)", av_get_pix_fmt_name(source_format),
+	              av_get_pix_fmt_name(target_format), (flags == SWS_POINT) ? "point" : "bilinear");
+
+	ffmpeg::swscale single, banded;
+	if (!initialize(single, source_format, target_format, width, height, flags, nullptr, 1)
+	    || !initialize(banded, source_format, target_format, width, height, flags, threads, band_count)) {
+		std::printf("  FAIL %s, %dx%d: could not create the contexts\n", name, width, height);
+		return false;
+	}
+	if (banded.get_band_count() <= 1) {
+		std::printf("  FAIL %s, %dx%d: not split into bands\n", name, width, height);
+		return false;
+	}
+
+	image source, expected, actual;
+	allocate_image(source, source_format, width, height);
+	allocate_image(expected, target_format, width, height);
+	allocate_image(actual, target_format, width, height);
+	fill_random(source, source_format);
+
+	int32_t single_rows =
+	    single.convert(source.data, source.linesize, 0, height, expected.data, expected.linesize);
+	int32_t banded_rows = banded.convert(source.data, source.linesize, 0, height, actual.data, actual.linesize);
+	if (single_rows != banded_rows) {
+		std::printf("  FAIL %s, %dx%d: %d rows converted, not %d\n", name, width, height, banded_rows,
+		            single_rows);
+		return false;
+	}
+	return compare_exact(expected, actual, name, width, height);
+}
+
+int main(int, char*[])
+{
+	struct conversion {
+		AVPixelFormat source;
+		AVPixelFormat target;
+	} conversions[] = {
+	    // 4:2:0, repacking and dithering down from 10 bits.
+	    {AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P},
+	    {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12},
+	    {AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P},
+	    {AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P10LE},
+	    // 4:2:2, packed to planar and dithering down from 10 bits.
+	    {AV_PIX_FMT_YUYV422, AV_PIX_FMT_YUV422P},
+	    {AV_PIX_FMT_UYVY422, AV_PIX_FMT_YUV422P},
+	    {AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_YUV422P},
+	};
+	// Heights that leave a short last band, and odd ones that leave a last chroma row of its own.
+	static const int sizes[][2] = {{1920, 1080}, {1280, 721}, {640, 360}, {352, 111}, {64, 66}, {33, 47}};
+	static const int flags[]    = {SWS_POINT, SWS_FAST_BILINEAR};
+
+	auto   threads  = std::make_shared<obsffmpeg::threadpool>(band_count);
+	size_t failures = 0;
+	size_t passes   = 0;
+	for (auto const& conv : conversions) {
+		for (auto const& size : sizes) {
+			for (int flag : flags) {
+				if (test_conversion(conv.source, conv.target, size[0], size[1], flag, threads)) {
+					passes++;
+				} else {
+					failures++;
+				}
+			}
+		}
+	}
+
+	std::printf("%zu conversions match, %zu differ.\n", passes, failures);
+	return failures ? 1 : 0;
+}